@@ -0,0 +1,56 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "command.h"
+
+//command names are looked up by perfect hash, table is const, so it is stored in flash
+
+//longest command name
+#define COMMAND_NAME_MAX 11
+
+typedef struct _t_command_entry
+{
+  const char *name;
+  t_command command;
+} t_command_entry;
+
+//indexed by COMMAND_HASH of name, slots are placed by hand and checked by test/test_command.c
+static const t_command_entry command_table[COMMAND_SLOTS]={
+  [25] = {"status", COMMAND_STATUS},
+  [15] = {"history", COMMAND_HISTORY},
+  [24] = {"stats", COMMAND_STATS},
+  [17] = {"mute", COMMAND_MUTE},
+  [27] = {"unmute", COMMAND_UNMUTE},
+  [12] = {"help", COMMAND_HELP},
+  [19] = {"latency", COMMAND_LATENCY},
+  [28] = {"subscribe", COMMAND_SUBSCRIBE},
+  [0] = {"unsubscribe", COMMAND_UNSUBSCRIBE},
+};
+
+//finds command in message text, args (may be NULL) receives text after command name
+//it does not allocate and rejects non-command text by its first character
+t_command command_parse(const char *text, const char **args)
+{
+  const t_command_entry *entry;
+  size_t len;
+
+  if(text == NULL || text[0]!=COMMAND_PREFIX) return COMMAND_NONE;
+  text++;
+
+  for(len=0;text[len] && text[len]!=' ' && text[len]!='\n';len++)
+  {
+    if(len>=COMMAND_NAME_MAX) return COMMAND_NONE;
+  }
+  if(len == 0) return COMMAND_NONE;
+
+  entry=&command_table[COMMAND_HASH(text, len)];
+  if(entry->name == NULL || strncmp(entry->name, text, len) != 0 || entry->name[len]) return COMMAND_NONE;
+
+  if(args)
+  {
+    text+=len;
+    while(*text==' ') text++;
+    *args=text;
+  }
+  return entry->command;
+}
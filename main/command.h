@@ -0,0 +1,43 @@
+#ifndef __COMMAND_H
+#define __COMMAND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//commands start with this character, anything else is not for us
+#define COMMAND_PREFIX '!'
+
+//slots of hash table of command names, power of 2
+#define COMMAND_SLOTS 32
+
+//hash of command name, it has no collisions for names in command table
+//adding a command means checking that its slot is still free (or changing the hash), test_command does it
+#define COMMAND_HASH(name, len) \
+  (((len) + (unsigned char)(name)[0]) & (COMMAND_SLOTS-1))
+
+//known commands
+typedef enum _t_command
+{
+  COMMAND_NONE = 0, //not a command or unknown one
+  COMMAND_STATUS, //current door state
+  COMMAND_HISTORY, //recent door changes
+  COMMAND_STATS, //bot statistics
+  COMMAND_MUTE, //stop door notifications for a while
+  COMMAND_UNMUTE, //resume door notifications
+  COMMAND_HELP, //list of commands
+  COMMAND_LATENCY, //notification latency per stage
+  COMMAND_SUBSCRIBE, //send changes of sensors to this channel
+  COMMAND_UNSUBSCRIBE, //stop sending changes of sensors to this channel
+  COMMAND_COUNT
+} t_command;
+
+//finds command in message text, args (may be NULL) receives text after command name
+//it does not allocate and rejects non-command text by its first character
+t_command command_parse(const char *text, const char **args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
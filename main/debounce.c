@@ -0,0 +1,56 @@
+#include <stddef.h>
+
+#include "debounce.h"
+
+//initializes debounce with current input level and hysteresis window in us
+void debounce_init(t_debounce *d, int level, int64_t window)
+{
+  d->window=window;
+  d->stable=!!level;
+  d->candidate=d->stable;
+  d->candidate_time=0;
+  d->pending=0;
+}
+
+//feeds raw edge (level after edge and its time), edges must come in time order
+//returns 1 and fills out when edge shows that previous candidate has been confirmed
+int debounce_edge(t_debounce *d, int level, int64_t t, t_debounce_event *out)
+{
+  int confirmed;
+
+  level=!!level;
+
+  //candidate may have been stable long enough before this edge came
+  confirmed=debounce_poll(d, t, out);
+
+  if(level!=d->candidate)
+  {
+    d->candidate=level;
+    d->candidate_time=t;
+  }
+  //same level again (missed opposite edge or bounce), window is counted from the first one
+  d->pending=(d->candidate!=d->stable);
+
+  return confirmed;
+}
+
+//checks candidate at time now, returns 1 and fills out when it has been confirmed
+int debounce_poll(t_debounce *d, int64_t now, t_debounce_event *out)
+{
+  if(!d->pending || now-d->candidate_time<d->window) return 0;
+
+  d->pending=0;
+  d->stable=d->candidate;
+  if(out)
+  {
+    out->level=d->stable;
+    out->time=d->candidate_time;
+  }
+  return 1;
+}
+
+//returns time when debounce_poll can confirm candidate, -1 when nothing is pending
+int64_t debounce_deadline(const t_debounce *d)
+{
+  return d->pending ? d->candidate_time+d->window : -1;
+}
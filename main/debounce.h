@@ -0,0 +1,45 @@
+#ifndef __DEBOUNCE_H
+#define __DEBOUNCE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//confirmed input transition
+typedef struct _t_debounce_event
+{
+  int level; //new level
+  int64_t time; //time of edge that started it, us
+} t_debounce_event;
+
+//debounce state of one input
+//level is confirmed when it stays unchanged for window
+typedef struct _t_debounce
+{
+  int64_t window; //hysteresis window, us
+  int stable; //last confirmed level
+  int candidate; //last seen level
+  int64_t candidate_time; //time of edge to candidate level
+  int pending; //candidate waits for confirmation
+} t_debounce;
+
+//initializes debounce with current input level and hysteresis window in us
+void debounce_init(t_debounce *d, int level, int64_t window);
+
+//feeds raw edge (level after edge and its time), edges must come in time order
+//returns 1 and fills out when edge shows that previous candidate has been confirmed
+int debounce_edge(t_debounce *d, int level, int64_t t, t_debounce_event *out);
+
+//checks candidate at time now, returns 1 and fills out when it has been confirmed
+int debounce_poll(t_debounce *d, int64_t now, t_debounce_event *out);
+
+//returns time when debounce_poll can confirm candidate, -1 when nothing is pending
+int64_t debounce_deadline(const t_debounce *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __DIB_CLOCK_H
+#define __DIB_CLOCK_H
+
+#include <stdint.h>
+
+//single monotonic time source of the bot, us since start
+//pure modules (debounce, rate_limit, led_pattern, command) get time as argument instead
+//DIB_HOST build (test/CMakeLists.txt) supplies its own, test/sim_clock.c is moved by tests only
+
+#ifdef DIB_HOST
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//provided by host build
+int64_t dib_clock_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#else
+
+#include "esp_timer.h"
+
+//esp_timer_get_time can be called from ISR
+#define dib_clock_us() esp_timer_get_time()
+
+#endif
+
+#endif
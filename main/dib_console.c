@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_console.h"
+
+#include "dib_console.h"
+#include "discordbot.h"
+#include "dlog.h"
+#include "latency.h"
+#include "metrics.h"
+#include "wifi_provisioning.h"
+
+#ifdef CONFIG_DIB_CONSOLE
+
+static const char *TAG = "dib_console";
+
+//output buffer of commands, console runs one command at a time
+static char console_buf[1024];
+
+//latency [reset], prints summary and histogram of every stage
+static int console_latency(int argc, char **argv)
+{
+  if(argc>1 && strcmp(argv[1], "reset") == 0)
+  {
+    latency_reset();
+    printf("Latency histograms cleared\n");
+    return 0;
+  }
+
+  latency_render(console_buf, sizeof(console_buf));
+  printf("%s\n", console_buf);
+
+  for(int s=0;s<LATENCY_STAGE_COUNT;s++)
+  {
+    if(latency_render_histogram((t_latency_stage)s, console_buf, sizeof(console_buf)) == 0) continue;
+    printf("-- %s\n%s\n", latency_stage_name((t_latency_stage)s), console_buf);
+  }
+  return 0;
+}
+
+//inject <sensor> <open|closed> [count] [interval_ms], pushes edges into relay path, level alternates
+//interval longer than debounce window lets every edge through, latency of notifications is then in 'latency'
+static int console_inject(int argc, char **argv)
+{
+  int sensor, open, count=1, interval=1000;
+  esp_err_t r;
+
+  if(argc<3)
+  {
+    printf("Usage: inject <sensor> <open|closed> [count] [interval_ms]\n");
+    return 1;
+  }
+  sensor=atoi(argv[1]);
+  open=strcasecmp(argv[2], "open") == 0 || strcmp(argv[2], "1") == 0;
+  if(argc>3) count=atoi(argv[3]);
+  if(argc>4) interval=atoi(argv[4]);
+  if(count<1 || interval<0)
+  {
+    printf("Count must be positive and interval not negative\n");
+    return 1;
+  }
+
+  for(int i=0;i<count;i++)
+  {
+    if(i) vTaskDelay(pdMS_TO_TICKS(interval));
+    r=dib_inject_edge(sensor, open);
+    if(r!=ESP_OK)
+    {
+      printf("Error 0x%x injecting edge %d of sensor %d\n", r, i+1, sensor);
+      return 1;
+    }
+    open=!open;
+  }
+  printf("%d edges injected\n", count);
+  return 0;
+}
+
+//stats, prints heap, stacks and CPU use of tasks and heap history
+static int console_stats(int argc, char **argv)
+{
+  metrics_render(console_buf, sizeof(console_buf));
+  printf("%s\n", console_buf);
+  metrics_render_heap(console_buf, sizeof(console_buf));
+  printf("-- heap history\n%s\n", console_buf);
+  return 0;
+}
+
+//wifi, prints connection state, backoff and reconnect counters
+static int console_wifi(int argc, char **argv)
+{
+  wifi_conn_status(console_buf, sizeof(console_buf));
+  printf("%s\n", console_buf);
+  return 0;
+}
+
+//log [module level], prints or sets runtime level of deferred log of module
+static int console_log(int argc, char **argv)
+{
+  static const char *const levels[]={"none", "error", "warn", "info", "debug", "verbose"};
+  int module, level;
+
+  if(argc>2)
+  {
+    module=dlog_module_find(argv[1]);
+    for(level=ESP_LOG_VERBOSE;level>=0 && strcasecmp(levels[level], argv[2])!=0;level--);
+    if(module<0 || level<0)
+    {
+      printf("Unknown module or level\n");
+      return 1;
+    }
+    dlog_level_set((t_dlog_module)module, (esp_log_level_t)level);
+  }
+
+  dlog_render_levels(console_buf, sizeof(console_buf));
+  printf("%s\n", console_buf);
+  return 0;
+}
+
+//starts REPL on console port (UART or USB Serial/JTAG) with diagnostic commands
+esp_err_t dib_console_start(void)
+{
+  esp_console_repl_t *repl=NULL;
+  esp_console_repl_config_t repl_config=ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+  esp_err_t r;
+
+  repl_config.prompt="dbot>";
+
+#if defined(CONFIG_ESP_CONSOLE_UART_DEFAULT) || defined(CONFIG_ESP_CONSOLE_UART_CUSTOM)
+  esp_console_dev_uart_config_t hw_config=ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+  r=esp_console_new_repl_uart(&hw_config, &repl_config, &repl);
+#elif defined(CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG)
+  esp_console_dev_usb_serial_jtag_config_t hw_config=ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+  r=esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl);
+#elif defined(CONFIG_ESP_CONSOLE_USB_CDC)
+  esp_console_dev_usb_cdc_config_t hw_config=ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+  r=esp_console_new_repl_usb_cdc(&hw_config, &repl_config, &repl);
+#else
+  r=ESP_ERR_NOT_SUPPORTED;
+#endif
+  if(r!=ESP_OK) goto FNRET;
+
+  esp_console_register_help_command();
+
+  const esp_console_cmd_t latency_cmd={
+    .command="latency",
+    .help="Door notification latency per stage, 'latency reset' clears it",
+    .hint="[reset]",
+    .func=console_latency,
+  };
+  r=esp_console_cmd_register(&latency_cmd);
+  if(r!=ESP_OK) goto FNRET;
+
+  const esp_console_cmd_t inject_cmd={
+    .command="inject",
+    .help="Pushes door edges of sensor (index) into relay path, level alternates, 'latency' shows the result",
+    .hint="<sensor> <open|closed> [count] [interval_ms]",
+    .func=console_inject,
+  };
+  r=esp_console_cmd_register(&inject_cmd);
+  if(r!=ESP_OK) goto FNRET;
+
+  const esp_console_cmd_t stats_cmd={
+    .command="stats",
+    .help="Heap, stack high-water marks and CPU use of tasks",
+    .func=console_stats,
+  };
+  r=esp_console_cmd_register(&stats_cmd);
+  if(r!=ESP_OK) goto FNRET;
+
+  const esp_console_cmd_t wifi_cmd={
+    .command="wifi",
+    .help="Wi-Fi connection state, reconnect backoff and counters",
+    .func=console_wifi,
+  };
+  r=esp_console_cmd_register(&wifi_cmd);
+  if(r!=ESP_OK) goto FNRET;
+
+  const esp_console_cmd_t log_cmd={
+    .command="log",
+    .help="Levels of deferred log, 'log sender debug' sets level of module",
+    .hint="[module none|error|warn|info|debug|verbose]",
+    .func=console_log,
+  };
+  r=esp_console_cmd_register(&log_cmd);
+  if(r!=ESP_OK) goto FNRET;
+
+  r=esp_console_start_repl(repl);
+
+FNRET:
+  ESP_LOGI(TAG, "Initialization return code=0X%x", r);
+  return r;
+}
+
+#else
+
+//starts REPL on console port (UART or USB Serial/JTAG) with diagnostic commands
+esp_err_t dib_console_start(void)
+{
+  return ESP_OK;
+}
+
+#endif
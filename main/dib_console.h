@@ -0,0 +1,18 @@
+#ifndef __DIB_CONSOLE_H
+#define __DIB_CONSOLE_H
+
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//starts REPL on console port (UART or USB Serial/JTAG) with diagnostic commands
+//it does nothing when console is disabled in menuconfig
+esp_err_t dib_console_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_timer.h"
+
+#include "dib_clock.h"
+#include "discord_rest.h"
+#include "dlog.h"
+
+static const char *TAG = "discord_rest";
+
+#ifdef CONFIG_DISCORD_API_BASE_URL
+#define DISCORD_API_URL CONFIG_DISCORD_API_BASE_URL
+#else
+#define DISCORD_API_URL "https://discord.com/api/v10"
+#endif
+#define DISCORD_REST_TIMEOUT_MS 10000
+//created message is parsed from this much of response
+#define DISCORD_REST_RESPONSE_MAX 2048
+//request body, 2000 chars of content fit even when every one of them is escaped by backslash
+#define DISCORD_REST_BODY_MAX 4096
+//webhook URL carries its token, it is longer than API paths
+#define DISCORD_REST_URL_MAX 256
+//kept-alive connection is closed after this long without request
+#define DISCORD_REST_IDLE_MS 30000
+
+#ifdef CONFIG_DISCORD_TOKEN
+#define DISCORD_REST_TOKEN CONFIG_DISCORD_TOKEN
+#else
+#define DISCORD_REST_TOKEN ""
+#endif
+
+//request buffers and client are allocated once, requests are serialized by lock
+static SemaphoreHandle_t discord_rest_lock;
+static StaticSemaphore_t discord_rest_lock_buf;
+static char discord_rest_url[DISCORD_REST_URL_MAX];
+static char discord_rest_body_buf[DISCORD_REST_BODY_MAX];
+static char discord_rest_response[DISCORD_REST_RESPONSE_MAX];
+
+//one client is kept, so that TLS connection is reused
+static esp_http_client_handle_t discord_rest_client;
+static int discord_rest_connected; //connection is (probably) open
+static int discord_rest_tls; //client has certificate bundle attached, it is set at init only
+static esp_timer_handle_t discord_rest_idle_timer;
+
+//helper, converts header value in (fractional) seconds to us
+static int64_t discord_rest_seconds(const char *value)
+{
+  return (int64_t)(strtod(value, NULL)*1000000.0);
+}
+
+//collects rate limit headers into result
+static esp_err_t discord_rest_event(esp_http_client_event_t *evt)
+{
+  t_discord_rest_result *res=(t_discord_rest_result *)evt->user_data;
+
+  if(evt->event_id != HTTP_EVENT_ON_HEADER || res == NULL) return ESP_OK;
+
+  if(strcasecmp(evt->header_key, "X-RateLimit-Limit") == 0) res->limit=atoi(evt->header_value);
+  else if(strcasecmp(evt->header_key, "X-RateLimit-Remaining") == 0) res->remaining=atoi(evt->header_value);
+  else if(strcasecmp(evt->header_key, "X-RateLimit-Reset-After") == 0) res->reset_after=discord_rest_seconds(evt->header_value);
+  else if(strcasecmp(evt->header_key, "Retry-After") == 0) res->retry_after=discord_rest_seconds(evt->header_value);
+
+  return ESP_OK;
+}
+
+//helper, renders {"content":"..."} with escaped content into body, returns length or -1 when it does not fit
+static int discord_rest_body(char *body, size_t size, const char *content)
+{
+  static const char head[]="{\"content\":\"";
+  static const char tail[]="\"}";
+  const char *c;
+  char *p=body, *end;
+
+  if(size<sizeof(head)+sizeof(tail)) return -1;
+  end=body+size-sizeof(tail);
+
+  memcpy(p, head, sizeof(head)-1);
+  p+=sizeof(head)-1;
+  for(c=content;*c;c++)
+  {
+    //worst case char becomes \u00XX
+    if(end-p<6) return -1;
+
+    if(*c=='"' || *c=='\\')
+    {
+      *p++='\\';
+      *p++=*c;
+    }
+    else if(*c=='\n')
+    {
+      *p++='\\';
+      *p++='n';
+    }
+    else if((unsigned char)*c<0x20)
+    {
+      p+=sprintf(p, "\\u%04x", (unsigned char)*c);
+    }
+    else
+    {
+      *p++=*c;
+    }
+  }
+  memcpy(p, tail, sizeof(tail));
+
+  return (int)(p-body)+sizeof(tail)-1;
+}
+
+//helper, finds string value of key at top level of JSON object, returns 0 when not found
+static int discord_rest_json_top_string(const char *json, const char *key, char *out, size_t size)
+{
+  int depth=0, in_string=0;
+  size_t key_len=strlen(key);
+  const char *p, *end;
+
+  for(p=json;*p;p++)
+  {
+    if(in_string)
+    {
+      if(*p=='\\' && p[1]) p++;
+      else if(*p=='"') in_string=0;
+      continue;
+    }
+
+    switch(*p)
+    {
+    case '{':
+    case '[':
+      depth++;
+      break;
+    case '}':
+    case ']':
+      depth--;
+      break;
+    case '"':
+      if(depth==1 && strncmp(p+1, key, key_len) == 0 && p[1+key_len]=='"')
+      {
+        //"key" : "value"
+        p+=key_len+2;
+        while(*p==' ' || *p==':') p++;
+        if(*p!='"') return 0;
+        end=strchr(++p, '"');
+        if(end == NULL || (size_t)(end-p)>=size) return 0;
+        memcpy(out, p, end-p);
+        out[end-p]=0;
+        return 1;
+      }
+      in_string=1;
+      break;
+    default:
+      break;
+    }
+  }
+  return 0;
+}
+
+//helper, resets result before attempt
+static void discord_rest_result_clear(t_discord_rest_result *res)
+{
+  res->status=0;
+  res->limit=-1;
+  res->remaining=-1;
+  res->reset_after=-1;
+  res->retry_after=-1;
+  res->request_time=0;
+  res->response_time=0;
+}
+
+//helper, closes kept-alive connection, TLS session ticket is kept for resumption
+//called with lock held
+static void discord_rest_disconnect(void)
+{
+  if(discord_rest_client && discord_rest_connected) esp_http_client_close(discord_rest_client);
+  discord_rest_connected=0;
+}
+
+//closes connection nobody uses, so that its TLS buffers go back to heap
+//runs in esp_timer task, it does not wait when request is in progress (it restarts the timer anyway)
+static void discord_rest_idle(void *arg)
+{
+  if(xSemaphoreTake(discord_rest_lock, 0)!=pdTRUE) return;
+  if(discord_rest_connected) DLOGD(DLOG_REST, "Closing idle connection");
+  discord_rest_disconnect();
+  xSemaphoreGive(discord_rest_lock);
+}
+
+//helper, creates client that is kept for all requests to url of the same scheme
+//webhook and API base may differ, client of other scheme is replaced, as bundle cannot be attached later
+//called with lock held
+static esp_err_t discord_rest_client_get(const char *url)
+{
+  int tls=strncmp(url, "https:", 6) == 0;
+
+  if(discord_rest_client)
+  {
+    if(discord_rest_tls == tls) return ESP_OK;
+    discord_rest_disconnect();
+    esp_http_client_cleanup(discord_rest_client);
+    discord_rest_client=NULL;
+  }
+
+  esp_http_client_config_t cfg = {
+    .url = url,
+    .timeout_ms = DISCORD_REST_TIMEOUT_MS,
+    //local stand-in of Discord may use plain http
+    .crt_bundle_attach = tls ? esp_crt_bundle_attach : NULL,
+    .event_handler = discord_rest_event,
+    .keep_alive_enable = true,
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    //reconnect resumes TLS session instead of full handshake
+    .save_client_session = true,
+#endif
+  };
+
+  discord_rest_client=esp_http_client_init(&cfg);
+  if(discord_rest_client == NULL) return ESP_ERR_NO_MEM;
+  discord_rest_tls=tls;
+
+#ifndef CONFIG_DISCORD_MODE_WEBHOOK
+  //webhook URL authorizes request by itself
+  esp_http_client_set_header(discord_rest_client, "Authorization", "Bot " DISCORD_REST_TOKEN);
+#endif
+  esp_http_client_set_header(discord_rest_client, "Content-Type", "application/json");
+  esp_http_client_set_header(discord_rest_client, "User-Agent", "DiscordBot (esp-discord-guard-bot, 1.0)");
+  return ESP_OK;
+}
+
+//helper, sends body over (possibly kept-alive) connection and reads response
+//res->status stays 0 when connection failed
+static esp_err_t discord_rest_exchange(int len, char *response, size_t response_size, t_discord_rest_result *res)
+{
+  esp_http_client_handle_t client=discord_rest_client;
+  esp_err_t r;
+  int read;
+
+  res->request_time=dib_clock_us();
+  r=esp_http_client_open(client, len);
+  if(r!=ESP_OK) return r;
+
+  if(esp_http_client_write(client, discord_rest_body_buf, len)!=len) return ESP_FAIL;
+
+  if(esp_http_client_fetch_headers(client)<0) return ESP_FAIL;
+
+  res->response_time=dib_clock_us();
+  res->status=esp_http_client_get_status_code(client);
+
+  if(response && response_size)
+  {
+    read=esp_http_client_read_response(client, response, response_size-1);
+    response[read>0 ? read : 0]=0;
+  }
+  //rest of body has to be read, otherwise connection cannot be used again
+  esp_http_client_flush_response(client, NULL);
+
+  if(res->status>=200 && res->status<300) return ESP_OK;
+  if(res->status==404) return ESP_ERR_NOT_FOUND;
+  if(res->status==429) return ESP_ERR_INVALID_STATE;
+  return ESP_FAIL;
+}
+
+//performs request to base URL followed by path, response (may be NULL) receives beginning of response body
+//connection is kept open for next request until it is idle for DISCORD_REST_IDLE_MS or it fails
+//called with lock held, uses static buffers
+static esp_err_t discord_rest_request(esp_http_client_method_t method, const char *base, const char *path, const char *content,
+  char *response, size_t response_size, t_discord_rest_result *res)
+{
+  esp_err_t r;
+  t_discord_rest_result tmp;
+  int len, reused;
+
+  if(res == NULL) res=&tmp;
+  discord_rest_result_clear(res);
+  if(response && response_size) response[0]=0;
+
+  if(snprintf(discord_rest_url, sizeof(discord_rest_url), "%s%s", base, path)>=(int)sizeof(discord_rest_url))
+  {
+    r=ESP_ERR_INVALID_SIZE;
+    goto FNRET;
+  }
+
+  len=discord_rest_body(discord_rest_body_buf, sizeof(discord_rest_body_buf), content);
+  if(len<0)
+  {
+    r=ESP_ERR_INVALID_SIZE;
+    goto FNRET;
+  }
+
+  r=discord_rest_client_get(discord_rest_url);
+  if(r!=ESP_OK) goto FNRET;
+
+  esp_timer_stop(discord_rest_idle_timer);
+  esp_http_client_set_url(discord_rest_client, discord_rest_url);
+  esp_http_client_set_method(discord_rest_client, method);
+  esp_http_client_set_user_data(discord_rest_client, res);
+
+  for(;;)
+  {
+    reused=discord_rest_connected;
+    discord_rest_connected=1;
+    r=discord_rest_exchange(len, response, response_size, res);
+    if(res->status) break;
+
+    //connection is broken, server may have closed kept-alive one meanwhile
+    discord_rest_disconnect();
+    if(!reused) break;
+    DLOGD(DLOG_REST, "Kept-alive connection lost, reconnecting");
+    discord_rest_result_clear(res);
+  }
+
+  if(discord_rest_connected) esp_timer_start_once(discord_rest_idle_timer, DISCORD_REST_IDLE_MS*1000ULL);
+
+FNRET:
+  if(r!=ESP_OK)
+  {
+    DLOGE(DLOG_REST, "Request (method %d) failed, err=0x%x, status=%d", method, r, res->status);
+  }
+  return r;
+}
+
+//creates lock guarding request buffers and timer closing idle connection
+esp_err_t discord_rest_init(void)
+{
+  if(discord_rest_lock) return ESP_OK;
+
+  const esp_timer_create_args_t idle_args = {
+    .callback = discord_rest_idle,
+    .name = "discord_rest_idle",
+  };
+  if(esp_timer_create(&idle_args, &discord_rest_idle_timer)!=ESP_OK) return ESP_ERR_NO_MEM;
+
+  discord_rest_lock=xSemaphoreCreateMutexStatic(&discord_rest_lock_buf);
+  if(discord_rest_lock == NULL) return ESP_FAIL;
+
+  //client is ready before network comes up, first send only connects
+  return discord_rest_client_get(DISCORD_API_URL);
+}
+
+//posts message with content to channel through REST API
+//message_id (may be NULL) receives id of created message, nothing is allocated when it is not needed
+//returns ESP_ERR_INVALID_STATE when rate limited (429)
+esp_err_t discord_rest_send(const char *channel_id, const char *content, char *message_id, size_t id_size, t_discord_rest_result *res)
+{
+  char path[96];
+  int want_id=(message_id && id_size);
+  esp_err_t r;
+
+  if(discord_rest_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  snprintf(path, sizeof(path), "/channels/%s/messages", channel_id);
+  if(want_id) message_id[0]=0;
+
+  xSemaphoreTake(discord_rest_lock, portMAX_DELAY);
+
+  r=discord_rest_request(HTTP_METHOD_POST, DISCORD_API_URL, path, content, want_id ? discord_rest_response : NULL, sizeof(discord_rest_response), res);
+  if(r==ESP_OK && want_id && !discord_rest_json_top_string(discord_rest_response, "id", message_id, id_size))
+  {
+    ESP_LOGW(TAG, "Message sent but its id is unknown");
+  }
+
+  xSemaphoreGive(discord_rest_lock);
+  return r;
+}
+
+//replaces content of message, returns ESP_ERR_NOT_FOUND when message does not exist anymore
+esp_err_t discord_rest_edit(const char *channel_id, const char *message_id, const char *content, t_discord_rest_result *res)
+{
+  char path[128];
+  esp_err_t r;
+
+  if(discord_rest_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  snprintf(path, sizeof(path), "/channels/%s/messages/%s", channel_id, message_id);
+
+  xSemaphoreTake(discord_rest_lock, portMAX_DELAY);
+  r=discord_rest_request(HTTP_METHOD_PATCH, DISCORD_API_URL, path, content, NULL, 0, res);
+  xSemaphoreGive(discord_rest_lock);
+  return r;
+}
+
+//executes webhook with content, message_id (may be NULL) receives id of created message
+//without message_id server does not wait for message to be created nor return it
+esp_err_t discord_rest_webhook_send(const char *webhook_url, const char *content, char *message_id, size_t id_size, t_discord_rest_result *res)
+{
+  int want_id=(message_id && id_size);
+  esp_err_t r;
+
+  if(discord_rest_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  if(want_id) message_id[0]=0;
+
+  xSemaphoreTake(discord_rest_lock, portMAX_DELAY);
+
+  r=discord_rest_request(HTTP_METHOD_POST, webhook_url, want_id ? "?wait=true" : "", content,
+    want_id ? discord_rest_response : NULL, sizeof(discord_rest_response), res);
+  if(r==ESP_OK && want_id && !discord_rest_json_top_string(discord_rest_response, "id", message_id, id_size))
+  {
+    ESP_LOGW(TAG, "Message sent but its id is unknown");
+  }
+
+  xSemaphoreGive(discord_rest_lock);
+  return r;
+}
+
+//replaces content of message created by webhook, returns ESP_ERR_NOT_FOUND when message does not exist anymore
+esp_err_t discord_rest_webhook_edit(const char *webhook_url, const char *message_id, const char *content, t_discord_rest_result *res)
+{
+  char path[64];
+  esp_err_t r;
+
+  if(discord_rest_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  snprintf(path, sizeof(path), "/messages/%s", message_id);
+
+  xSemaphoreTake(discord_rest_lock, portMAX_DELAY);
+  r=discord_rest_request(HTTP_METHOD_PATCH, webhook_url, path, content, NULL, 0, res);
+  xSemaphoreGive(discord_rest_lock);
+  return r;
+}
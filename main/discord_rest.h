@@ -0,0 +1,47 @@
+#ifndef __DISCORD_REST_H
+#define __DISCORD_REST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//what server told about request, negative values are unknown
+typedef struct _t_discord_rest_result
+{
+  int status; //HTTP status, 0 when request has not been made
+  int limit; //X-RateLimit-Limit
+  int remaining; //X-RateLimit-Remaining
+  int64_t reset_after; //X-RateLimit-Reset-After in us
+  int64_t retry_after; //Retry-After of 429 in us
+  int64_t request_time; //dib_clock time request started to go out, 0 when it has not
+  int64_t response_time; //dib_clock time response headers arrived, 0 when they have not
+} t_discord_rest_result;
+
+//creates client, lock guarding request buffers and timer closing idle connection, call once before sending
+esp_err_t discord_rest_init(void);
+
+//posts message with content to channel through REST API
+//message_id (may be NULL) receives id of created message, nothing is allocated when it is not needed
+//returns ESP_ERR_INVALID_STATE when rate limited (429)
+esp_err_t discord_rest_send(const char *channel_id, const char *content, char *message_id, size_t id_size, t_discord_rest_result *res);
+
+//replaces content of message, returns ESP_ERR_NOT_FOUND when message does not exist anymore
+esp_err_t discord_rest_edit(const char *channel_id, const char *message_id, const char *content, t_discord_rest_result *res);
+
+//executes webhook (https://discord.com/api/webhooks/<id>/<token>) with content
+//message_id (may be NULL) receives id of created message, server responds sooner when it is not needed
+esp_err_t discord_rest_webhook_send(const char *webhook_url, const char *content, char *message_id, size_t id_size, t_discord_rest_result *res);
+
+//replaces content of message created by webhook, returns ESP_ERR_NOT_FOUND when message does not exist anymore
+esp_err_t discord_rest_webhook_edit(const char *webhook_url, const char *message_id, const char *content, t_discord_rest_result *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,193 +1,941 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+#include <time.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "freertos/projdefs.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_task.h"
 #include "esp_event.h"
 #include "nvs_flash.h"
+#include "nvs.h"
 
 #include "driver/gpio.h"
 
 #include "discord.h"
 #include "discord/session.h"
 #include "discord/message.h"
-#include "estr.h"
 
 #include "discordbot.h"
+#include "dib_clock.h"
+#include "debounce.h"
+#include "relay_ring.h"
+#include "outbox.h"
+#include "rate_limit.h"
+#include "journal.h"
+#include "discord_rest.h"
+#include "command.h"
+#include "latency.h"
+#include "metrics.h"
+#include "sensor.h"
+#include "subscribers.h"
+#include "dlog.h"
+
+#ifdef CONFIG_DISCORD_LIVE_STATUS
+#include "esp_netif_sntp.h"
+#endif
 
 static const char *TAG = "discord_bot";
 
+//REST-only modes do not open gateway, door changes are posted to configured channel or webhook
+#if defined(CONFIG_DISCORD_MODE_REST) || defined(CONFIG_DISCORD_MODE_WEBHOOK)
+#define DIB_REST_ONLY
+#endif
+
+#ifndef DIB_REST_ONLY
 static discord_handle_t bot;
+#endif
 
-#define RELAY_GPIO GPIO_NUM_20
+//monitored inputs, "name:gpio[:active[:debounce_ms]],..." string "sensors" in NVS takes precedence
+#ifdef CONFIG_SENSORS
+#define SENSORS_SPEC CONFIG_SENSORS
+#else
+#define SENSORS_SPEC "Door:20"
+#endif
+
+#ifdef CONFIG_RELAY_DEBOUNCE_MS
+#define RELAY_DEBOUNCE_MS CONFIG_RELAY_DEBOUNCE_MS
+#else
+#define RELAY_DEBOUNCE_MS 50
+#endif
 
+//channel that gets all changes until subscriber table is changed by commands, set before sender starts
 #ifdef CONFIG_DISCORD_CHANNEL_ID
-static char cached_channel_id[256] = CONFIG_DISCORD_CHANNEL_ID;
+static char default_channel_id[OUTBOX_ID_MAX] = CONFIG_DISCORD_CHANNEL_ID;
 #else
-static char cached_channel_id[256] = "";
+static char default_channel_id[OUTBOX_ID_MAX] = "";
+#endif
+
+#ifdef CONFIG_DISCORD_MODE_WEBHOOK
+//messages go to webhook, channel id is just name of its rate limit route
+#define WEBHOOK_ROUTE "webhook"
+static char webhook_url[256] = CONFIG_DISCORD_WEBHOOK_URL;
+#endif
+
+//bot can send, written by gateway events and network callbacks, read by relay and sender tasks
+static atomic_int connected;
+
+//Discord refuses longer message content
+#define DISCORD_CONTENT_MAX 2000
+
+//message templates, messages are rendered into send_buf or straight into outbox
+#define MSG_DOOR_OPEN "OPEN " DISCORD_EMOJI_X
+#define MSG_DOOR_CLOSED "closed " DISCORD_EMOJI_WHITE_CHECK_MARK
+#define MSG_DOOR "%s is %s"
+#define MSG_DOOR_AGE " (%.1f s ago)"
+#define MSG_DOOR_CHANGES ", changed %d times"
+#define MSG_HISTORY_HEAD "\nRecent changes:"
+#define MSG_HISTORY_LINE "\n- %s %s %s"
+#define MSG_HISTORY_EMPTY "No door changes since start"
+#define MSG_ALARM "%s OPENED " DISCORD_EMOJI_X
+#define MSG_STATS "Uptime %lld s, first message %lld ms after boot, door changes %d, messages sent %d, failed %d, " \
+  "chat messages parsed %d, commands %d"
+#define MSG_MUTED "Door notifications muted for %ld min"
+#define MSG_UNMUTED "Door notifications resumed"
+#define MSG_LATENCY "```\n%s\n```"
+#define MSG_LATENCY_RESET "Latency histograms cleared"
+#define MSG_SUBSCRIBED "This channel gets changes of: %s"
+#define MSG_SUBSCRIBED_NONE "This channel gets no changes"
+#define MSG_SUBSCRIBE_UNKNOWN "Unknown sensor `%.*s`, sensors are: %s"
+#define MSG_SUBSCRIBE_FULL "Too many channels subscribed, unsubscribe some first"
+#define MSG_HELP "Commands: `!status` state of sensors, `!history` recent changes, `!stats` bot statistics, " \
+  "`!latency [reset]` notification latency, `!mute [min]` silence door notifications, `!unmute` resume them, " \
+  "`!subscribe [sensor ...]` / `!unsubscribe [sensor ...]` changes in this channel, " \
+  "`!help` this list"
+
+//rendered message content, used by sender task only so that nothing is allocated per message
+static char send_buf[DISCORD_CONTENT_MAX + 1];
+
+//NVS namespace of bot settings
+#define DIB_NVS_NAMESPACE "dbot"
+
+//number of recent changes shown by live status and !history
+#define HISTORY_MAX 5
+
+//recent door change
+typedef struct _t_history_change
+{
+  int sensor;
+  int level;
+  int64_t edge_time; //dib_clock time, us
+} t_history_change;
+
+//recent door changes, written by relay task, read by sender task and command handler
+static SemaphoreHandle_t history_lock;
+static t_history_change history[HISTORY_MAX]; //newest first
+static int history_len;
+
+//door notifications are not sent until this dib_clock time, us
+#define MUTE_DEFAULT_MIN 60
+#define MUTE_MAX_MIN (24 * 60)
+static _Atomic int64_t muted_until;
+
+//statistics shown by !stats
+static atomic_int stat_changes;
+static atomic_int stat_sent;
+static atomic_int stat_failed;
+static _Atomic int64_t stat_first_sent; //dib_clock time of first sent message, us
+#ifndef DIB_REST_ONLY
+//every message esp-discord has deserialized for us, chatter included, and commands among them
+static atomic_int stat_messages;
+static atomic_int stat_commands;
 #endif
 
-static int connected = 0;
+//stack sizes of tasks, check high-water marks by !stats or console before changing them
+#define SENDER_TASK_STACK 4096
+#define RELAY_TASK_STACK 4096
+
+//back-off after failed send, doubles up to max
+#define SEND_BACKOFF_MIN_US 1000000LL
+#define SEND_BACKOFF_MAX_US 60000000LL
+
+//every subscriber and default channel keep their bucket during fan-out, LRU eviction would reset them each round
+_Static_assert(RATE_LIMIT_ROUTES_MAX >= SUBSCRIBERS_MAX + 1, "rate limit table is smaller than fan-out");
+
+//sensors being monitored, set before relay task starts
+static t_sensor_cfg sensors[SENSORS_MAX];
+static int sensors_len;
+
+//last confirmed level of sensors, 1 open
+static atomic_int sensor_level[SENSORS_MAX];
+
+//returns name of sensor index
+static const char *sensor_name(int sensor)
+{
+  return (sensor >= 0 && sensor < sensors_len) ? sensors[sensor].name : "?";
+}
+
+//loads sensor list from NVS, Kconfig one is used when it is not there or it is malformed
+static void sensors_load(void)
+{
+  char spec[SENSORS_MAX * 32];
+  nvs_handle_t h;
+  size_t len = sizeof(spec);
+  int n = -1;
+
+  if (nvs_open(DIB_NVS_NAMESPACE, NVS_READONLY, &h) == ESP_OK)
+  {
+    if (nvs_get_str(h, "sensors", spec, &len) == ESP_OK)
+    {
+      n = sensor_parse(spec, RELAY_DEBOUNCE_MS, sensors, SENSORS_MAX);
+      if (n < 0) ESP_LOGE(TAG, "Sensors \"%s\" in NVS are malformed", spec);
+    }
+    nvs_close(h);
+  }
+
+  if (n < 0) n = sensor_parse(SENSORS_SPEC, RELAY_DEBOUNCE_MS, sensors, SENSORS_MAX);
+  if (n < 0)
+  {
+    ESP_LOGE(TAG, "Sensors \"%s\" are malformed", SENSORS_SPEC);
+    n = 0;
+  }
+  sensors_len = n;
+
+  for (int i = 0; i < sensors_len; i++)
+  {
+    ESP_LOGI(TAG, "Sensor %s: GPIO %d, open at %d, debounce %d ms", sensors[i].name, sensors[i].gpio,
+      sensors[i].active, sensors[i].debounce_ms);
+  }
+}
 
-//tries to send realy state do discord channel
-static void send_relay_state(char *channel_id)
+//renders current state of all sensors into buf, one per line, returns length
+static size_t sensors_render(char *buf, size_t size)
 {
-  if(!connected) return; //cannot send messages
+  size_t len = 0;
 
-  if (channel_id)
+  if (size == 0) return 0;
+  buf[0] = 0;
+  for (int i = 0; i < sensors_len && len < size; i++)
   {
-    // copy channel id for future use
-    ESP_LOGI(TAG, "Going to store channel_id=%s",channel_id);
-    cached_channel_id[0] = 0;
-    strncat(cached_channel_id, channel_id, sizeof(cached_channel_id) / sizeof(cached_channel_id[0]) - 1);
+    len += snprintf(buf + len, size - len, "%s" MSG_DOOR, i ? "\n" : "", sensors[i].name,
+      atomic_load(&sensor_level[i]) ? MSG_DOOR_OPEN : MSG_DOOR_CLOSED);
   }
-  if (cached_channel_id[0])
+  return len < size ? len : size - 1;
+}
+
+//remembers door change for live status and !history
+static void history_add(int sensor, int level, int64_t edge_time)
+{
+  if (history_lock == NULL) return;
+
+  xSemaphoreTake(history_lock, portMAX_DELAY);
+  memmove(&history[1], &history[0], sizeof(history[0]) * (HISTORY_MAX - 1));
+  history[0].sensor = sensor;
+  history[0].level = level;
+  history[0].edge_time = edge_time;
+  if (history_len < HISTORY_MAX) history_len++;
+  xSemaphoreGive(history_lock);
+}
+
+#if !defined(DIB_REST_ONLY) || defined(CONFIG_DISCORD_LIVE_STATUS)
+//renders when edge happened, Discord shows relative time to reader when clock is synchronized
+static void history_when(char *buf, size_t size, int64_t edge_time)
+{
+  time_t now = time(NULL);
+
+  if (now > 1600000000)
+  {
+    snprintf(buf, size, "<t:%lld:R>", (long long)(now - (dib_clock_us() - edge_time) / 1000000));
+  }
+  else
   {
-    // we know channel_id
-    ESP_LOGI(TAG, "Going to send message to channel_id=%s",cached_channel_id);
+    snprintf(buf, size, "at uptime %lld s", (long long)(edge_time / 1000000));
+  }
+}
 
-    char *content = estr_cat("Door is ", gpio_get_level(RELAY_GPIO) ? "OPEN " DISCORD_EMOJI_X : "closed " DISCORD_EMOJI_WHITE_CHECK_MARK);
+//renders recent changes into buf, returns length, 0 when there are none
+static size_t history_render(char *buf, size_t size)
+{
+  char when[40];
+  size_t len = 0;
 
-    discord_message_t msg = {.content = content, .channel_id = cached_channel_id};
+  if (history_lock == NULL || size == 0) return 0;
+  buf[0] = 0;
 
-    discord_message_t *sent_msg = NULL;
-    esp_err_t err = discord_message_send(bot, &msg, &sent_msg);
-    free(content);
+  xSemaphoreTake(history_lock, portMAX_DELAY);
+  if (history_len > 0) len = snprintf(buf, size, MSG_HISTORY_HEAD);
+  for (int i = 0; i < history_len && len < size; i++)
+  {
+    history_when(when, sizeof(when), history[i].edge_time);
+    len += snprintf(buf + len, size - len, MSG_HISTORY_LINE, sensor_name(history[i].sensor),
+      history[i].level ? "opened" : "closed", when);
+  }
+  xSemaphoreGive(history_lock);
 
-    if (err == ESP_OK)
-    {
-      ESP_LOGI(TAG, "Relay status message successfully sent");
+  return len < size ? len : size - 1;
+}
+#endif
 
-      if (sent_msg)
-      { // null check because message can be sent but not returned
-        ESP_LOGI(TAG, "Relay status message got ID #%s", sent_msg->id?sent_msg->id:"UNKNOWN");
-        discord_message_free(sent_msg);
-      }
-    }
-    else
+//loads channel (and webhook) messages go to from NVS, Kconfig values are used when they are not there
+static void target_load(void)
+{
+  nvs_handle_t h;
+  size_t len;
+
+  if (nvs_open(DIB_NVS_NAMESPACE, NVS_READONLY, &h) == ESP_OK)
+  {
+    len = sizeof(default_channel_id);
+    if (nvs_get_str(h, "channel", default_channel_id, &len) == ESP_OK) ESP_LOGI(TAG, "Channel %s set in NVS", default_channel_id);
+#ifdef CONFIG_DISCORD_MODE_WEBHOOK
+    len = sizeof(webhook_url);
+    if (nvs_get_str(h, "webhook", webhook_url, &len) == ESP_OK) ESP_LOGI(TAG, "Webhook set in NVS");
+#endif
+    nvs_close(h);
+  }
+
+#ifdef CONFIG_DISCORD_MODE_WEBHOOK
+  strcpy(default_channel_id, WEBHOOK_ROUTE);
+  if (!webhook_url[0]) ESP_LOGE(TAG, "Webhook URL is not configured, nothing will be sent");
+#endif
+}
+
+//posts message to channel (or webhook), message_id (may be NULL) receives id of created message
+//called from sender task only
+static esp_err_t post_message(const char *channel_id, const char *content, char *message_id, size_t id_size, t_discord_rest_result *res)
+{
+#ifdef CONFIG_DISCORD_MODE_WEBHOOK
+  return discord_rest_webhook_send(webhook_url, content, message_id, id_size, res);
+#else
+  return discord_rest_send(channel_id, content, message_id, id_size, res);
+#endif
+}
+
+#ifdef CONFIG_DISCORD_LIVE_STATUS
+//replaces content of message posted by post_message
+//called from sender task only
+static esp_err_t edit_message(const char *channel_id, const char *message_id, const char *content, t_discord_rest_result *res)
+{
+#ifdef CONFIG_DISCORD_MODE_WEBHOOK
+  return discord_rest_webhook_edit(webhook_url, message_id, content, res);
+#else
+  return discord_rest_edit(channel_id, message_id, content, res);
+#endif
+}
+#endif
+
+//renders door message into send_buf, it is sent to every subscriber as it is
+//called from sender task only
+static void render_door(const t_outbox_msg *door)
+{
+  int64_t edge_time=door->edge_time;
+  int64_t now=dib_clock_us();
+  size_t len;
+
+#ifdef CONFIG_DISCORD_LIVE_STATUS
+  if (!door->channel_id[0])
+  {
+    //status of every sensor is in one message, any change refreshes all of them
+    len = sensors_render(send_buf, sizeof(send_buf));
+    history_render(send_buf + len, sizeof(send_buf) - len);
+    return;
+  }
+#endif
+
+  if (door->sensor == OUTBOX_SENSOR_ALL)
+  {
+    //state query, not a change
+    sensors_render(send_buf, sizeof(send_buf));
+    return;
+  }
+
+  len = snprintf(send_buf, sizeof(send_buf), MSG_DOOR, sensor_name(door->sensor), door->level ? MSG_DOOR_OPEN : MSG_DOOR_CLOSED);
+  //tell how old the news is when it is delayed
+  if(edge_time>0 && now-edge_time>=1000000)
+  {
+    len += snprintf(send_buf + len, sizeof(send_buf) - len, MSG_DOOR_AGE, (now-edge_time)/1000000.0);
+  }
+  //digest of changes that were merged while waiting
+  if(door->changes>1)
+  {
+    snprintf(send_buf + len, sizeof(send_buf) - len, MSG_DOOR_CHANGES, door->changes);
+  }
+}
+
+#ifdef CONFIG_DISCORD_LIVE_STATUS
+//edits live status message of subscriber in place, it is posted when it does not exist yet
+//only opening posts a new (alarm) message
+//called from sender task only
+static esp_err_t send_live_status(const t_outbox_msg *door, int slot, const char *channel_id, t_discord_rest_result *res)
+{
+  char message_id[OUTBOX_ID_MAX];
+  esp_err_t err = ESP_ERR_NOT_FOUND;
+
+  subscribers_status_get(slot, message_id, sizeof(message_id));
+  if (message_id[0])
+  {
+    err = edit_message(channel_id, message_id, send_buf, res);
+  }
+
+  if (err == ESP_ERR_NOT_FOUND)
+  {
+    //message has been deleted or channel is new, start new one
+    err = post_message(channel_id, send_buf, message_id, sizeof(message_id), res);
+    if (err == ESP_OK && message_id[0]) subscribers_status_set(slot, message_id);
+  }
+
+  if (err == ESP_OK)
+  {
+    DLOGI(DLOG_SENDER, "Live status of subscriber %d updated", slot);
+#ifdef CONFIG_DISCORD_LIVE_ALARM_ON_OPEN
+    if (door->edge_time && door->level) outbox_post_textf(channel_id, MSG_ALARM, sensor_name(door->sensor));
+#endif
+  }
+  else
+  {
+    DLOGE(DLOG_SENDER, "Fail to update live status of subscriber %d", slot);
+  }
+  return err;
+}
+#endif
+
+//merges following texts for the same channel into send_buf, returns content to send
+//called from sender task only when rate limit is close
+static const char *fold_texts(t_outbox_msg *text)
+{
+  t_outbox_msg next;
+  size_t len = strlen(text->content), next_len;
+  int folded = 0;
+
+  while (outbox_take_text(text->channel_id, &next))
+  {
+    next_len = strlen(next.content);
+    if (len + 1 + next_len > DISCORD_CONTENT_MAX)
     {
-      ESP_LOGE(TAG, "Fail to send Relay status message");
+      outbox_requeue(&next);
+      break;
     }
+    if (folded == 0) memcpy(send_buf, text->content, len);
+    send_buf[len++] = '\n';
+    memcpy(send_buf + len, next.content, next_len + 1);
+    len += next_len;
+    folded++;
   }
+
+  if (folded == 0) return text->content;
+
+  DLOGI(DLOG_SENDER, "%d messages folded to save rate limit", folded);
+  return send_buf;
 }
 
-//handles discord bot events
-static void bot_event_handler(void *handler_arg, esp_event_base_t base, int32_t event_id, void *event_data)
+//sends rendered content of message to one channel, slot is subscriber index, -1 for reply
+//called from sender task only
+static esp_err_t send_to(const t_outbox_msg *msg, int slot, const char *channel_id, const char *content, t_discord_rest_result *res)
 {
-  discord_event_data_t *data = (discord_event_data_t *)event_data;
+  esp_err_t err;
 
-  switch (event_id)
+#ifdef CONFIG_DISCORD_LIVE_STATUS
+  if (msg->kind == OUTBOX_DOOR && slot >= 0) return send_live_status(msg, slot, channel_id, res);
+#endif
+
+  err = post_message(channel_id, content, NULL, 0, res);
+  if (err == ESP_OK)
   {
-  case DISCORD_EVENT_CONNECTED:
+    DLOGI(DLOG_SENDER, "Message of kind %d sent to subscriber %d", msg->kind, slot);
+  }
+  else
   {
-    discord_session_t *session = (discord_session_t *)data->ptr;
-    connected=1;
+    DLOGE(DLOG_SENDER, "Fail to send message of kind %d to subscriber %d", msg->kind, slot);
+  }
+  return err;
+}
 
-    ESP_LOGI(TAG, "Bot %s#%s connected", session->user->username, session->user->discriminator);
+//feeds stage timestamps of sent message into latency histograms
+//called from sender task only
+static void record_latency(const t_outbox_msg *msg, const t_discord_rest_result *res)
+{
+  if (res->response_time) latency_record(LATENCY_HTTP, res->response_time - res->request_time);
 
-    send_relay_state(NULL);
+  //rest is known for door changes only
+  if (msg->kind != OUTBOX_DOOR || msg->edge_time == 0 || msg->decide_time == 0) return;
 
+  latency_record(LATENCY_DEBOUNCE, msg->decide_time - msg->edge_time);
+  latency_record(LATENCY_RELAY, msg->enqueue_time - msg->decide_time);
+  if (res->request_time)
+  {
+    latency_record(LATENCY_QUEUE, res->request_time - msg->enqueue_time);
+    latency_record(LATENCY_REQUEST, res->request_time - msg->edge_time);
   }
-  break;
+  if (res->response_time)
+  {
+    latency_record(LATENCY_TOTAL, res->response_time - msg->edge_time);
+    DLOGD(DLOG_SENDER, "Door change to response latency %d ms", (int)((res->response_time - msg->edge_time) / 1000));
+  }
+}
 
-  case DISCORD_EVENT_MESSAGE_RECEIVED:
+// converts us to wait into ticks, rounds up so that deadline has passed when we wake up
+static TickType_t us_to_ticks(int64_t us)
+{
+  int64_t ms = (us + 999) / 1000;
+
+  if (ms <= 0) return 0;
+  return (TickType_t)((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+//result of delivery to one channel
+typedef enum _t_send_result
+{
+  SEND_DONE = 0,
+  SEND_WAIT, //rate limited, nothing was sent
+  SEND_FAILED
+} t_send_result;
+
+//sends rendered message to one channel through its token bucket
+//wait is lowered to time its bucket needs to refill, backoff is doubled on failure
+//called from sender task only
+static t_send_result send_through_bucket(const t_outbox_msg *msg, int slot, const char *channel_id, const char *content,
+  int64_t *wait, int64_t *backoff)
+{
+  t_discord_rest_result res;
+  t_rate_limit *rl;
+  int64_t now, delay;
+  esp_err_t err;
+
+  now = dib_clock_us();
+  rl = rate_limit_route(channel_id, now);
+  delay = rate_limit_wait(rl, now);
+  if (delay > 0)
   {
-    discord_message_t *msg = (discord_message_t *)data->ptr;
+    DLOGI(DLOG_SENDER, "Rate limit of subscriber %d, waiting %d ms", slot, (int)(delay / 1000));
+    if (*wait < 0 || delay < *wait) *wait = delay;
+    return SEND_WAIT;
+  }
+
+  rate_limit_consume(rl, now);
+  res.status = 0;
+  res.request_time = 0;
+  res.response_time = 0;
+  err = send_to(msg, slot, channel_id, content, &res);
 
-    ESP_LOGI(TAG,
-             "New message (dm=%s, author=%s#%s, bot=%s, channel=%s, guild=%s, content=%s)",
-             !msg->guild_id ? "true" : "false",
-             msg->author->username,
-             msg->author->discriminator,
-             msg->author->bot ? "true" : "false",
-             msg->channel_id,
-             msg->guild_id ? msg->guild_id : "NULL",
-             msg->content);
-
-    if (msg->content && msg->content[0])
+  record_latency(msg, &res);
+
+  //server tells us its limits
+  if (res.status)
+  {
+    now = dib_clock_us();
+    rate_limit_update(rl, now, res.limit, res.remaining, res.reset_after);
+    if (res.status == 429 && res.retry_after > 0) rate_limit_block(rl, now, res.retry_after);
+  }
+
+  if (err == ESP_OK)
+  {
+    //boot to first notification is what counts after power cut
+    if (atomic_fetch_add(&stat_sent, 1) == 0)
     {
+      atomic_store(&stat_first_sent, dib_clock_us());
+      ESP_LOGI(TAG, "First message sent %lld ms after boot", (long long)(atomic_load(&stat_first_sent) / 1000));
+    }
+    *backoff = SEND_BACKOFF_MIN_US;
+    return SEND_DONE;
+  }
 
-      char *echo_content = estr_cat("Hey ", msg->author->username, " you wrote `", msg->content, "`");
+  //do not hammer the API, channel is tried again after backoff
+  atomic_fetch_add(&stat_failed, 1);
+  now = dib_clock_us();
+  rate_limit_block(rl, now, *backoff);
+  if (*wait < 0 || *backoff < *wait) *wait = *backoff;
+  if (*backoff < SEND_BACKOFF_MAX_US) *backoff *= 2;
+  return SEND_FAILED;
+}
+
+//sends queued messages one by one, so that slow HTTPS requests do not block relay task nor gateway
+//message is rendered once and fanned out to subscribers of its sensor, replies and texts go to their channel only
+//every channel has its token bucket, messages wait in outbox (and get merged) while the bucket is empty
+static void discord_sender_task(void *arg)
+{
+  t_outbox_msg msg;
+  t_send_result sr;
+  t_rate_limit *rl;
+  char channel_id[OUTBOX_ID_MAX];
+  const char *content;
+  uint32_t last_seq = 0;
+  int64_t now, delay, backoff = SEND_BACKOFF_MIN_US;
+  TickType_t wait;
+  int pending, sensor;
 
-      discord_message_t echo = {.content = echo_content, .channel_id = msg->channel_id};
+  outbox_set_consumer(xTaskGetCurrentTaskHandle());
 
-      discord_message_t *sent_msg = NULL;
-      esp_err_t err = discord_message_send(bot, &echo, &sent_msg);
-      free(echo_content);
+  for(;;)
+  {
+    wait = portMAX_DELAY;
 
-      if (err == ESP_OK)
+    while(outbox_take(&msg))
+    {
+      if (!atomic_load(&connected))
       {
-        ESP_LOGI(TAG, "Echo message successfully sent");
+        //cannot send messages, state is sent again after connecting
+        //changes queued before link went down are journaled here, later ones never get queued
+        if (msg.kind == OUTBOX_DOOR && msg.sensor >= 0 && msg.edge_time) journal_append(msg.sensor, msg.level, msg.edge_time);
+        continue;
+      }
 
-        if (sent_msg)
-        { // null check because message can be sent but not returned
-          ESP_LOGI(TAG, "Echo message got ID #%s", sent_msg->id);
-          discord_message_free(sent_msg);
-        }
+      //render once
+      content = send_buf;
+      switch (msg.kind)
+      {
+      case OUTBOX_JOURNAL:
+        if (journal_summary(send_buf, sizeof(send_buf), sensor_name, &last_seq) == 0) continue; //nothing to send
+        break;
+      case OUTBOX_DOOR:
+        render_door(&msg);
+        break;
+      case OUTBOX_TEXT:
+        content = msg.content;
+        //fold only when bucket is low but not empty, one request is cheaper than several
+        now = dib_clock_us();
+        rl = rate_limit_route(msg.channel_id, now);
+        if (rate_limit_wait(rl, now) == 0 && rate_limit_low(rl, now)) content = fold_texts(&msg);
+        break;
+      default:
+        continue;
+      }
+
+      delay = -1;
+      pending = 0;
+
+      if (msg.kind == OUTBOX_TEXT || msg.channel_id[0])
+      {
+        //reply to channel that asked
+        sr = send_through_bucket(&msg, -1, msg.channel_id, content, &delay, &backoff);
+        //text is given up when sending fails, door state is tried again
+        if (sr == SEND_WAIT || (sr == SEND_FAILED && msg.kind != OUTBOX_TEXT)) pending = 1;
       }
       else
       {
-        ESP_LOGE(TAG, "Fail to send echo message");
+        //changes of sensor go to its subscribers, state of all sensors and journal to every subscriber
+        sensor = msg.kind == OUTBOX_DOOR ? msg.sensor : -1;
+        for (int slot = 0; slot < SUBSCRIBERS_MAX; slot++)
+        {
+          if ((msg.done >> slot) & 1) continue;
+          if (!subscribers_get(slot, sensor, channel_id, sizeof(channel_id))) continue;
+
+          sr = send_through_bucket(&msg, slot, channel_id, content, &delay, &backoff);
+          if (sr == SEND_DONE) msg.done |= 1 << slot;
+          else pending = 1;
+        }
+        if (!pending && msg.kind == OUTBOX_JOURNAL) journal_clear(last_seq);
       }
 
-      send_relay_state(msg->channel_id);
+      if (pending)
+      {
+        //keep it and everything behind it until buckets refill, delivered channels are not sent again
+        outbox_requeue(&msg);
+        wait = us_to_ticks(delay);
+        break;
+      }
     }
+
+    //wait for new messages or for rate limit to pass
+    ulTaskNotifyTake(pdTRUE, wait);
   }
-  break;
+}
 
-  case DISCORD_EVENT_MESSAGE_UPDATED:
+//bot can send again, tells what happened while it could not, then current state
+static void bot_online(void)
+{
+  atomic_store(&connected, 1);
+  if (journal_count() > 0) outbox_post_journal();
+  outbox_post_door(NULL, OUTBOX_SENSOR_ALL, 0, 0, 0);
+}
+
+#ifndef DIB_REST_ONLY
+//renders names of sensors in mask, separated by comma
+static void sensors_names(uint32_t mask, char *buf, size_t size)
+{
+  size_t len = 0;
+
+  buf[0] = 0;
+  for (int i = 0; i < sensors_len && len < size; i++)
   {
-    discord_message_t *msg = (discord_message_t *)data->ptr;
-    ESP_LOGI(TAG,
-             "%s has updated his message (#%s). New content: %s",
-             msg->author->username,
-             msg->id,
-             msg->content);
+    if ((mask >> i) & 1) len += snprintf(buf + len, size - len, "%s%s", len ? ", " : "", sensors[i].name);
+  }
+}
+
+//finds sensors named in args (separated by space or comma), no names mean all sensors
+//returns 0 and unknown name in bad / bad_len when some name is not known
+static int sensors_mask(const char *args, uint32_t *mask, const char **bad, int *bad_len)
+{
+  size_t len;
+  int i;
+
+  *mask = 0;
+  for (;;)
+  {
+    args += strspn(args, " ,\n");
+    len = strcspn(args, " ,\n");
+    if (len == 0) break;
+    if (len == 3 && strncasecmp(args, "all", 3) == 0)
+    {
+      *mask = SUBSCRIBERS_ALL;
+    }
+    else
+    {
+      for (i = 0; i < sensors_len; i++)
+      {
+        if (strlen(sensors[i].name) == len && strncasecmp(sensors[i].name, args, len) == 0) break;
+      }
+      if (i >= sensors_len)
+      {
+        *bad = args;
+        *bad_len = (int)len;
+        return 0;
+      }
+      *mask |= 1u << i;
+    }
+    args += len;
+  }
+
+  if (*mask == 0) *mask = SUBSCRIBERS_ALL;
+  return 1;
+}
+
+//changes subscription of channel by !subscribe / !unsubscribe and tells channel what it gets now
+//called from bot event handler
+static esp_err_t subscribe(const char *channel_id, const char *args, int add)
+{
+  char names[SENSORS_MAX * SENSOR_NAME_MAX + 16];
+  const char *bad;
+  int bad_len;
+  uint32_t mask;
+  esp_err_t r;
+
+  if (!sensors_mask(args, &mask, &bad, &bad_len))
+  {
+    sensors_names(SUBSCRIBERS_ALL, names, sizeof(names));
+    return outbox_post_textf(channel_id, MSG_SUBSCRIBE_UNKNOWN, bad_len, bad, names);
+  }
+
+  r = subscribers_update(channel_id, add ? mask : 0, add ? 0 : mask, &mask);
+  if (r == ESP_ERR_NO_MEM) return outbox_post_text(channel_id, MSG_SUBSCRIBE_FULL);
+
+  ESP_LOGI(TAG, "Channel %s subscribed to sensors 0x%lx", channel_id, (unsigned long)mask);
+  sensors_names(mask, names, sizeof(names));
+  if (!names[0]) return outbox_post_text(channel_id, MSG_SUBSCRIBED_NONE);
+  return outbox_post_textf(channel_id, MSG_SUBSCRIBED, names);
+}
+
+//executes command from message, replies are queued to outbox
+//called from bot event handler, it must not block on sending
+static void handle_command(discord_message_t *msg)
+{
+  char reply[OUTBOX_TEXT_MAX];
+  const char *args;
+  size_t len;
+  long minutes;
+  t_command command;
+  esp_err_t r = ESP_OK;
+
+  command = command_parse(msg->content, &args);
+  //message buffers are gone before log is printed, command number is enough
+  DLOGI(DLOG_BOT, "Command %d received", command);
+  switch (command)
+  {
+  case COMMAND_STATUS:
+    r = outbox_post_door(msg->channel_id, OUTBOX_SENSOR_ALL, 0, 0, 0);
+    break;
+
+  case COMMAND_HISTORY:
+    if (history_render(reply, sizeof(reply)) == 0) r = outbox_post_text(msg->channel_id, MSG_HISTORY_EMPTY);
+    else r = outbox_post_text(msg->channel_id, reply + 1); //skip leading new line
+    break;
+
+  case COMMAND_STATS:
+    len = snprintf(reply, sizeof(reply), MSG_STATS "\n", (long long)(dib_clock_us() / 1000000),
+      (long long)(atomic_load(&stat_first_sent) / 1000), atomic_load(&stat_changes), atomic_load(&stat_sent), atomic_load(&stat_failed),
+      atomic_load(&stat_messages), atomic_load(&stat_commands));
+    if (len < sizeof(reply)) metrics_render(reply + len, sizeof(reply) - len);
+    r = outbox_post_text(msg->channel_id, reply);
+    break;
+
+  case COMMAND_MUTE:
+    minutes = strtol(args, NULL, 10);
+    if (minutes <= 0) minutes = MUTE_DEFAULT_MIN;
+    if (minutes > MUTE_MAX_MIN) minutes = MUTE_MAX_MIN;
+    atomic_store(&muted_until, dib_clock_us() + minutes * 60000000LL);
+    r = outbox_post_textf(msg->channel_id, MSG_MUTED, minutes);
+    break;
+
+  case COMMAND_UNMUTE:
+    atomic_store(&muted_until, 0);
+    r = outbox_post_text(msg->channel_id, MSG_UNMUTED);
+    break;
+
+  case COMMAND_LATENCY:
+    if (strncmp(args, "reset", 5) == 0)
+    {
+      latency_reset();
+      r = outbox_post_text(msg->channel_id, MSG_LATENCY_RESET);
+    }
+    else
+    {
+      latency_render(reply, sizeof(reply) - sizeof(MSG_LATENCY)); //room for code block
+      r = outbox_post_textf(msg->channel_id, MSG_LATENCY, reply);
+    }
+    break;
+
+  case COMMAND_SUBSCRIBE:
+  case COMMAND_UNSUBSCRIBE:
+    r = subscribe(msg->channel_id, args, command == COMMAND_SUBSCRIBE);
+    break;
+
+  case COMMAND_HELP:
+    r = outbox_post_text(msg->channel_id, MSG_HELP);
+    break;
+
+  default:
+    return;
+  }
+
+  if (r != ESP_OK) ESP_LOGE(TAG, "Fail to queue reply to %s", msg->content);
+}
+
+//gateway events handled by bot_event_handler
+static const discord_event_t bot_events[] = {
+  DISCORD_EVENT_CONNECTED,
+  DISCORD_EVENT_MESSAGE_RECEIVED,
+  DISCORD_EVENT_DISCONNECTED,
+};
+
+//handles discord bot events
+static void bot_event_handler(void *handler_arg, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+  discord_event_data_t *data = (discord_event_data_t *)event_data;
+
+  switch (event_id)
+  {
+  case DISCORD_EVENT_CONNECTED:
+  {
+    discord_session_t *session = (discord_session_t *)data->ptr;
+
+    ESP_LOGI(TAG, "Bot %s#%s connected", session->user->username, session->user->discriminator);
+    bot_online();
   }
   break;
 
-  case DISCORD_EVENT_MESSAGE_DELETED:
+  case DISCORD_EVENT_MESSAGE_RECEIVED:
   {
     discord_message_t *msg = (discord_message_t *)data->ptr;
-    ESP_LOGI(TAG, "Message #%s deleted", msg->id);
+
+    //esp-discord has already parsed the whole payload, that cost is paid for chatter as well
+    //and it shows as CPU of the gateway task in !stats, here chatter only skips logging, copying and sending
+    atomic_fetch_add(&stat_messages, 1);
+    if (msg->content == NULL || msg->content[0] != COMMAND_PREFIX) break;
+    if (msg->author == NULL || msg->author->bot) break;
+
+    atomic_fetch_add(&stat_commands, 1);
+    handle_command(msg);
   }
   break;
 
   case DISCORD_EVENT_DISCONNECTED:
-    connected=0;
+    atomic_store(&connected, 0);
     ESP_LOGW(TAG, "Bot logged out");
     break;
   }
 }
+#endif
 
 
+//link loss is known well before gateway notices it, journal changes right away
+//gateway reconnect marks bot connected again, REST-only modes are online as soon as network is
+void dib_network(int up)
+{
+  if (!up && atomic_exchange(&connected, 0))
+  {
+    ESP_LOGW(TAG, "Network down, journaling door changes");
+  }
+#ifdef DIB_REST_ONLY
+  if (up && !atomic_load(&connected)) bot_online();
+#endif
+}
+
 /***************************************************** */
 /** RELAY CODE */
 
-// relay state change function
-static void relay_state_changed(int)
+// ISR context, edges of all inputs are passed to relay task through one ring
+typedef struct _t_relay_capture
+{
+  gpio_num_t gpio_num[SENSORS_MAX]; //pin of sensor index
+  TaskHandle_t task; //relay monitoring task
+  t_relay_ring ring;
+} t_relay_capture;
+
+static t_relay_capture relay_capture;
+
+//ring has single producer, pushes of dib_inject_edge and ISR must not overlap
+//single core targets (ESP32-C3) only mask interrupts, ISR takes the lock on dual core ones
+static portMUX_TYPE relay_inject_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// relay state change function, level is 1 when sensor is open
+static void relay_state_changed(int sensor, int level, int64_t edge_time)
 {
-  send_relay_state(NULL);
+  int64_t decide_time = dib_clock_us();
+
+  DLOGI(DLOG_RELAY, "%s changed to %d at %d ms", DLOG_S(sensor_name(sensor)), level, (int)(edge_time / 1000));
+  atomic_store(&sensor_level[sensor], level);
+  atomic_fetch_add(&stat_changes, 1);
+  history_add(sensor, level, edge_time);
+  //nobody would hear about it, keep it for later, sender journals it when link goes down before it is sent
+  if (!atomic_load(&connected))
+  {
+    journal_append(sensor, level, edge_time);
+    return;
+  }
+  //muted by !mute, change is still in history
+  if (dib_clock_us() < atomic_load(&muted_until)) return;
+  outbox_post_door(NULL, sensor, level, edge_time, decide_time);
 }
 
-// ISR that handles relay state change
+// ISR that handles state change of any input, records sensor, time and level of edge
 static void IRAM_ATTR relay_isr_handler(void *arg)
 {
-  TaskHandle_t xTaskToNotify = (TaskHandle_t)arg;
+  int sensor = (int)(intptr_t)arg;
   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-  if (xTaskToNotify)
+
+#ifndef CONFIG_FREERTOS_UNICORE
+  taskENTER_CRITICAL_ISR(&relay_inject_lock);
+#endif
+  relay_ring_push(&relay_capture.ring, sensor, dib_clock_us(), gpio_get_level(relay_capture.gpio_num[sensor]));
+#ifndef CONFIG_FREERTOS_UNICORE
+  taskEXIT_CRITICAL_ISR(&relay_inject_lock);
+#endif
+
+  if (relay_capture.task)
   {
-    vTaskNotifyGiveFromISR(xTaskToNotify, &xHigherPriorityTaskWoken);
+    vTaskNotifyGiveFromISR(relay_capture.task, &xHigherPriorityTaskWoken);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
   }
 }
 
+// pushes edge of sensor as if its input has just changed, it measures latency without touching doors
+// real input level is not changed, next real edge of the sensor is reported as usual
+esp_err_t dib_inject_edge(int sensor, int open)
+{
+  int pushed;
+
+  if (sensor < 0 || sensor >= sensors_len) return ESP_ERR_INVALID_ARG;
+  if (relay_capture.task == NULL) return ESP_ERR_INVALID_STATE;
+
+  taskENTER_CRITICAL(&relay_inject_lock);
+  pushed = relay_ring_push(&relay_capture.ring, sensor, dib_clock_us(), open ? sensors[sensor].active : !sensors[sensor].active);
+  taskEXIT_CRITICAL(&relay_inject_lock);
+
+  xTaskNotifyGive(relay_capture.task);
+  return pushed ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
 // MUST be called from task that monitors relay!
-esp_err_t configure_relay(gpio_num_t gpio_num)
+esp_err_t configure_relay(int sensor, gpio_num_t gpio_num)
 {
   esp_err_t r;
-  TaskHandle_t xTaskToNotify = xTaskGetCurrentTaskHandle();
+
+  relay_capture.gpio_num[sensor] = gpio_num;
+  relay_capture.task = xTaskGetCurrentTaskHandle();
 
   gpio_config_t io_conf = {
       .intr_type = GPIO_INTR_ANYEDGE,
@@ -200,50 +948,97 @@ esp_err_t configure_relay(gpio_num_t gpio_num)
   r = gpio_config(&io_conf);
   if (r) goto FNRET;
 
-  // hook isr handler for specific gpio pin
-  r = gpio_isr_handler_add(gpio_num, relay_isr_handler, (void *)xTaskToNotify);
+  // hook isr handler for specific gpio pin, the same handler serves all of them
+  r = gpio_isr_handler_add(gpio_num, relay_isr_handler, (void *)(intptr_t)sensor);
   if (r) goto FNRET;
 
 FNRET:
-  ESP_LOGI("configure_relay", "Initialization return code=%d", r);
+  ESP_LOGI("configure_relay", "%s on GPIO %d, initialization return code=%d", sensor_name(sensor), gpio_num, r);
   return r;
 }
 
-// accepts gpio_num_t* which holds pin GPIO with relay being connected
-// it expects, that gpio_install_isr_service has already been called
+// helper, returns whether raw level of sensor means open
+static int sensor_open(int sensor, int raw)
+{
+  return raw == sensors[sensor].active;
+}
+
+// monitors all sensors, it expects that gpio_install_isr_service has already been called
+// edges are debounced in time they happened, so every transition longer than debounce window is reported
 static void relay_monitoring_task(void *arg)
 {
-  esp_err_t r = ESP_OK - 1;
-  gpio_num_t gpio_num = 0;
-  int relay_state;
+  t_debounce debounce[SENSORS_MAX];
+  uint8_t monitored[SENSORS_MAX];
+  t_debounce_event event;
+  t_relay_edge edge;
+  int64_t deadline, d, now, last_edge = 0;
+  TickType_t wait;
+  int i, count = 0;
 
-  if (arg)
+  for (i = 0; i < sensors_len; i++)
   {
-    gpio_num = *((gpio_num_t *)arg);
-    r = configure_relay(gpio_num);
+    if (configure_relay(i, (gpio_num_t)sensors[i].gpio) != ESP_OK)
+    {
+      //its edges are ignored, following sensors are still monitored
+      ESP_LOGE(TAG, "%s on GPIO %d is not monitored", sensor_name(i), sensors[i].gpio);
+      monitored[i] = 0;
+      continue;
+    }
+    monitored[i] = 1;
+    debounce_init(&debounce[i], sensor_open(i, gpio_get_level(sensors[i].gpio)), sensors[i].debounce_ms * 1000LL);
+    //initial state is not a change, it is reported once bot connects
+    atomic_store(&sensor_level[i], debounce[i].stable);
+    count++;
   }
-  if (r != ESP_OK)
+  if (count == 0)
   {
     // we have nothing to do :/
     vTaskSuspend(NULL);
   }
 
-  relay_state = !gpio_get_level(gpio_num);
-
   while (2 + 3 * 4 == 14)
   {
-    if (relay_state != gpio_get_level(gpio_num))
+    //poll time is taken before draining, edges arriving meanwhile are later than it and they are seen next round
+    //polling with later time could confirm level that such an edge has already broken
+    now = dib_clock_us();
+
+    while (relay_ring_pop(&relay_capture.ring, &edge))
+    {
+      last_edge = edge.time;
+      if (edge.sensor >= sensors_len || !monitored[edge.sensor]) continue;
+      if (debounce_edge(&debounce[edge.sensor], sensor_open(edge.sensor, edge.level), edge.time, &event))
+      {
+        relay_state_changed(edge.sensor, event.level, event.time);
+      }
+    }
+
+    if (relay_ring_overflowed(&relay_capture.ring))
     {
-      relay_state = gpio_get_level(gpio_num);
-      ESP_LOGI("relay_monitoring_task", "Relay state changed to %d!", relay_state);
-      //send new state to Discord
-      relay_state_changed(relay_state);
-      //ignore short state changes
-      vTaskDelay(pdMS_TO_TICKS(500));
+      //some edges are lost, continue from current levels
+      //they get time of last taken edge, edges still in ring are not older, so debounce sees them in order
+      DLOGW(DLOG_RELAY, "Edge buffer overflow");
+      for (i = 0; i < sensors_len; i++)
+      {
+        if (!monitored[i]) continue;
+        if (debounce_edge(&debounce[i], sensor_open(i, gpio_get_level(sensors[i].gpio)), last_edge, &event))
+        {
+          relay_state_changed(i, event.level, event.time);
+        }
+      }
     }
-    //wait for relay state change
-    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-    ESP_LOGI("relay_monitoring_task", "Notification received!");
+
+    //confirm pending levels, then wait for next edge or until nearest pending level gets confirmed
+    deadline = -1;
+    for (i = 0; i < sensors_len; i++)
+    {
+      if (!monitored[i]) continue;
+      if (debounce_poll(&debounce[i], now, &event)) relay_state_changed(i, event.level, event.time);
+      d = debounce_deadline(&debounce[i]);
+      if (d >= 0 && (deadline < 0 || d < deadline)) deadline = d;
+    }
+
+    wait = deadline < 0 ? portMAX_DELAY : us_to_ticks(deadline - dib_clock_us());
+    ulTaskNotifyTake(pdTRUE, wait);
   }
 }
 
@@ -251,31 +1046,93 @@ static void relay_monitoring_task(void *arg)
 /***************************************************** */
 
 
-esp_err_t dib_start()
+// starts everything that does not need network, relay edges are captured (and journaled) from now on
+esp_err_t dib_init()
 {
-  gpio_num_t gpio_relay_num = RELAY_GPIO;
   BaseType_t t;
   esp_err_t r = ESP_OK - 1;
 
+  r = outbox_init();
+  if (r) goto FNRET;
+
+  r = journal_init();
+  if (r) goto FNRET;
+
+  r = discord_rest_init();
+  if (r) goto FNRET;
+
+  target_load();
+  sensors_load();
+
+  history_lock = xSemaphoreCreateMutex();
+  if (history_lock == NULL)
+  {
+    r = ESP_ERR_NO_MEM;
+    goto FNRET;
+  }
+
+#ifdef DIB_REST_ONLY
+  //one configured target, nothing could edit subscriber table without gateway commands
+  r = subscribers_init_single(default_channel_id);
+#else
+  r = subscribers_init(default_channel_id);
+#endif
+  if (r) goto FNRET;
+  r = ESP_OK - 1;
+
+  // start sender task
+  t = xTaskCreate(discord_sender_task, "discord_sender_task", SENDER_TASK_STACK, NULL, 4, NULL);
+  ESP_LOGI(TAG, "Sender task creation return code=%d", t);
+  if (t!=pdPASS) goto FNRET;
+
   // install gpio isr service
   gpio_install_isr_service(0);
 
   // start gpio task
-  t = xTaskCreate(relay_monitoring_task, "relay_monitoring_task", 4096, &gpio_relay_num, 5, NULL);
+  t = xTaskCreate(relay_monitoring_task, "relay_monitoring_task", RELAY_TASK_STACK, NULL, 5, NULL);
   ESP_LOGI(TAG, "Monitoring task creation return code=%d", t);
   if (t!=pdPASS) goto FNRET;
-  
+
+  r = ESP_OK;
+
+  FNRET:
+  ESP_LOGI("dib_init", "Initialization return code=0X%x", r);
+  return r;
+}
+
+// connects bot to Discord, dib_init must have been called and network must be up
+esp_err_t dib_start()
+{
+  esp_err_t r = ESP_OK - 1;
+
+#ifdef CONFIG_DISCORD_LIVE_STATUS
+  // wall clock lets Discord show times of changes
+  esp_sntp_config_t sntp_cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
+  esp_netif_sntp_init(&sntp_cfg);
+#endif
+
+#ifdef DIB_REST_ONLY
+  //no gateway, websocket, heartbeat nor JSON parser, door changes go through REST only
+  ESP_LOGI(TAG, "REST-only mode, gateway is not used");
+  r = ESP_OK;
+  goto FNRET;
+#else
   // discord_config_t cfg = { .intents = DISCORD_INTENT_GUILD_MESSAGES | DISCORD_INTENT_MESSAGE_CONTENT };
   discord_config_t cfg = {.intents = DISCORD_INTENT_GUILD_MESSAGES};
 
   bot = discord_create(&cfg);
   if (bot==NULL) goto FNRET;
 
-  r=discord_register_events(bot, DISCORD_EVENT_ANY, bot_event_handler, NULL);
-  if (r) goto FNRET;
+  //only events bot acts on, edits and deletions of messages do not reach handler
+  for (size_t i = 0; i < sizeof(bot_events) / sizeof(bot_events[0]); i++)
+  {
+    r=discord_register_events(bot, bot_events[i], bot_event_handler, NULL);
+    if (r) goto FNRET;
+  }
 
   r=discord_login(bot);
   if (r) goto FNRET;
+#endif
 
   FNRET:
   ESP_LOGI("dib_start", "Initialization return code=0X%x", r);
@@ -6,9 +6,18 @@
 extern "C" {
 #endif
 
-/* initializes and starts discord bod tasks*/
+/* starts relay capture and sender, does not need network */
+esp_err_t dib_init();
+
+/* connects discord bot, network must be up */
 esp_err_t dib_start();
 
+/* tells bot whether network link is up, door changes are journaled while it is down */
+void dib_network(int up);
+
+/* pushes edge of sensor (index) into relay path as if the input changed to open (1) or closed (0) now */
+esp_err_t dib_inject_edge(int sensor, int open);
+
 
 #ifdef __cplusplus
 }
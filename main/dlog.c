@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "dib_clock.h"
+#include "dlog.h"
+
+static const char *TAG = "dlog";
+
+#ifdef CONFIG_DLOG_LEVEL
+#define DLOG_LEVEL_DEFAULT CONFIG_DLOG_LEVEL
+#else
+#define DLOG_LEVEL_DEFAULT ESP_LOG_INFO
+#endif
+
+//records buffered between writers and dlog task, must be power of 2
+#define DLOG_RING_SIZE 64
+#define DLOG_RING_MASK (DLOG_RING_SIZE-1)
+
+//printing is the slow part, it runs when nothing else wants CPU
+#define DLOG_TASK_STACK 3072
+#define DLOG_TASK_PRIO 1
+//longest formatted message
+#define DLOG_LINE_MAX 160
+
+//binary record, format is pointer to literal, it is formatted by dlog task
+typedef struct _t_dlog_record
+{
+  int64_t time; //dib_clock time, us
+  const char *fmt;
+  uint8_t module;
+  uint8_t level;
+  uint8_t nargs;
+  intptr_t args[DLOG_ARGS_MAX];
+} t_dlog_record;
+
+//cell of lock-free multi-producer single-consumer ring
+typedef struct _t_dlog_cell
+{
+  atomic_uint seq; //pos when free for producer of pos, pos+1 when filled for consumer
+  t_dlog_record record;
+} t_dlog_cell;
+
+static t_dlog_cell dlog_ring[DLOG_RING_SIZE];
+static atomic_uint dlog_ring_enq; //next position for producers
+static unsigned int dlog_ring_deq; //next position for consumer, owned by dlog task
+static atomic_uint dlog_dropped; //records lost because ring was full or task was not running
+static atomic_int dlog_ready;
+static TaskHandle_t dlog_task_handle;
+static atomic_int dlog_wake; //dlog task has been notified and has not looked at ring yet
+
+_Atomic uint8_t dlog_levels[DLOG_MODULE_COUNT] = {
+  [0 ... DLOG_MODULE_COUNT-1] = DLOG_LEVEL_DEFAULT
+};
+
+static const char *const dlog_module_names[DLOG_MODULE_COUNT] = {
+  [DLOG_BOT] = "bot",
+  [DLOG_RELAY] = "relay",
+  [DLOG_OUTBOX] = "outbox",
+  [DLOG_SENDER] = "sender",
+  [DLOG_REST] = "rest",
+};
+
+static const char *const dlog_level_names[] = {"none", "error", "warn", "info", "debug", "verbose"};
+
+//wakes dlog task unless it has been woken already, safe to be called from ISR
+static void dlog_notify(void)
+{
+  if(atomic_exchange(&dlog_wake, 1)) return;
+
+  if(xPortInIsrContext())
+  {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(dlog_task_handle, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+  }
+  else
+  {
+    xTaskNotifyGive(dlog_task_handle);
+  }
+}
+
+//stores record, args are DLOG_ARGS_MAX at most, use DLOG macros instead
+void dlog_write(t_dlog_module module, esp_log_level_t level, const char *fmt, const intptr_t *args, int nargs)
+{
+  t_dlog_cell *cell;
+  unsigned int pos, seq;
+  int diff;
+
+  if(!atomic_load_explicit(&dlog_ready, memory_order_acquire))
+  {
+    atomic_fetch_add_explicit(&dlog_dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  //reserve cell at dlog_ring_enq
+  pos=atomic_load_explicit(&dlog_ring_enq, memory_order_relaxed);
+  for(;;)
+  {
+    cell=&dlog_ring[pos & DLOG_RING_MASK];
+    seq=atomic_load_explicit(&cell->seq, memory_order_acquire);
+    diff=(int)(seq-pos);
+    if(diff==0)
+    {
+      //cell is free, try to take it
+      if(atomic_compare_exchange_weak_explicit(&dlog_ring_enq, &pos, pos+1, memory_order_relaxed, memory_order_relaxed)) break;
+    }
+    else if(diff<0)
+    {
+      //ring is full, dlog task is behind
+      atomic_fetch_add_explicit(&dlog_dropped, 1, memory_order_relaxed);
+      dlog_notify();
+      return;
+    }
+    else
+    {
+      //other producer was faster
+      pos=atomic_load_explicit(&dlog_ring_enq, memory_order_relaxed);
+    }
+  }
+
+  if(nargs>DLOG_ARGS_MAX) nargs=DLOG_ARGS_MAX;
+  cell->record.time=dib_clock_us();
+  cell->record.fmt=fmt;
+  cell->record.module=(uint8_t)module;
+  cell->record.level=(uint8_t)level;
+  cell->record.nargs=(uint8_t)nargs;
+  memcpy(cell->record.args, args, nargs*sizeof(args[0]));
+  //publish cell to consumer
+  atomic_store_explicit(&cell->seq, pos+1, memory_order_release);
+
+  //only first record after dlog task has looked at ring wakes it, burst costs one notification
+  dlog_notify();
+}
+
+//helper, takes one record out of ring, returns 0 when ring is empty
+//called from dlog task only
+static int dlog_ring_pop(t_dlog_record *out)
+{
+  unsigned int pos=dlog_ring_deq;
+  t_dlog_cell *cell=&dlog_ring[pos & DLOG_RING_MASK];
+  unsigned int seq=atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+  if((int)(seq-(pos+1))<0) return 0; //not filled yet
+
+  *out=cell->record;
+  //hand cell back to producers for next round
+  atomic_store_explicit(&cell->seq, pos+DLOG_RING_SIZE, memory_order_release);
+  dlog_ring_deq=pos+1;
+  return 1;
+}
+
+//helper, appends padded text to buf
+static size_t dlog_put(char *buf, size_t size, size_t len, const char *text, size_t text_len, int width, int left, char pad)
+{
+  int n=(int)text_len;
+
+  for(;!left && n<width && len+1<size;n++) buf[len++]=pad;
+  for(size_t i=0;i<text_len && len+1<size;i++) buf[len++]=text[i];
+  for(;left && n<width && len+1<size;n++) buf[len++]=' ';
+  return len;
+}
+
+//formats record, supports %d %i %u %x %X %c %s %p %% with flags '-' '0' and width
+size_t dlog_format(char *buf, size_t size, const char *fmt, const intptr_t *args, int nargs)
+{
+  char num[24];
+  const char *s;
+  size_t len=0, num_len;
+  int arg=0, width, left;
+  char pad, conv;
+  uintptr_t v;
+
+  if(size == 0) return 0;
+
+  for(;*fmt && len+1<size;fmt++)
+  {
+    if(*fmt!='%')
+    {
+      buf[len++]=*fmt;
+      continue;
+    }
+
+    fmt++;
+    left=0;
+    pad=' ';
+    width=0;
+    for(;*fmt=='-' || *fmt=='0';fmt++)
+    {
+      if(*fmt=='-') left=1; else pad='0';
+    }
+    for(;*fmt>='0' && *fmt<='9';fmt++) width=width*10+(*fmt-'0');
+    while(*fmt=='l' || *fmt=='h' || *fmt=='z') fmt++; //values are intptr_t anyway
+    conv=*fmt;
+    if(conv == 0) break;
+
+    if(conv=='%')
+    {
+      buf[len++]='%';
+      continue;
+    }
+
+    //missing argument is printed as 0
+    v=(uintptr_t)(arg<nargs ? args[arg] : 0);
+    arg++;
+
+    switch(conv)
+    {
+    case 'd':
+    case 'i':
+      num_len=snprintf(num, sizeof(num), "%ld", (long)(intptr_t)v);
+      len=dlog_put(buf, size, len, num, num_len, width, left, pad);
+      break;
+    case 'u':
+      num_len=snprintf(num, sizeof(num), "%lu", (unsigned long)v);
+      len=dlog_put(buf, size, len, num, num_len, width, left, pad);
+      break;
+    case 'x':
+    case 'X':
+    case 'p':
+      num_len=snprintf(num, sizeof(num), conv=='X' ? "%lX" : "%lx", (unsigned long)v);
+      len=dlog_put(buf, size, len, num, num_len, width, left, pad);
+      break;
+    case 'c':
+      num[0]=(char)v;
+      len=dlog_put(buf, size, len, num, 1, width, left, ' ');
+      break;
+    case 's':
+      s=v ? (const char *)v : "(null)";
+      len=dlog_put(buf, size, len, s, strlen(s), width, left, ' ');
+      break;
+    default:
+      //unknown conversion is printed as it is
+      len=dlog_put(buf, size, len, fmt-1, 2, 0, 0, ' ');
+      break;
+    }
+  }
+
+  buf[len]=0;
+  return len;
+}
+
+//prints records as ESP_LOG does, while nothing else wants CPU
+//sleeps until first record is written, there is no periodic wakeup
+static void dlog_task(void *arg)
+{
+  static char line[DLOG_LINE_MAX];
+  t_dlog_record rec;
+  unsigned int dropped;
+
+  for(;;)
+  {
+    //records published from now on notify again, the ones before are seen by loop below
+    atomic_store(&dlog_wake, 0);
+
+    while(dlog_ring_pop(&rec))
+    {
+      dlog_format(line, sizeof(line), rec.fmt, rec.args, rec.nargs);
+      esp_log_write((esp_log_level_t)rec.level, dlog_module_names[rec.module], "%c (%lu) %s: %s\n",
+        "NEWIDV"[rec.level<=ESP_LOG_VERBOSE ? rec.level : ESP_LOG_VERBOSE], (unsigned long)(rec.time/1000),
+        dlog_module_names[rec.module], line);
+    }
+
+    dropped=atomic_exchange_explicit(&dlog_dropped, 0, memory_order_relaxed);
+    if(dropped) ESP_LOGW(TAG, "%u records dropped", dropped);
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+//starts task printing records, records written before are dropped
+esp_err_t dlog_start(void)
+{
+  if(atomic_load(&dlog_ready)) return ESP_OK;
+
+  for(unsigned int i=0;i<DLOG_RING_SIZE;i++) atomic_init(&dlog_ring[i].seq, i);
+  atomic_init(&dlog_ring_enq, 0);
+  dlog_ring_deq=0;
+
+  atomic_init(&dlog_wake, 0);
+
+  if(xTaskCreate(dlog_task, "dlog_task", DLOG_TASK_STACK, NULL, DLOG_TASK_PRIO, &dlog_task_handle)!=pdPASS)
+  {
+    ESP_LOGE(TAG, "Error creating task");
+    return ESP_ERR_NO_MEM;
+  }
+
+  atomic_store_explicit(&dlog_ready, 1, memory_order_release);
+  return ESP_OK;
+}
+
+//sets runtime level of module
+void dlog_level_set(t_dlog_module module, esp_log_level_t level)
+{
+  if(module<0 || module>=DLOG_MODULE_COUNT) return;
+  atomic_store(&dlog_levels[module], (uint8_t)level);
+}
+
+//returns module by name, -1 when there is none
+int dlog_module_find(const char *name)
+{
+  for(int i=0;i<DLOG_MODULE_COUNT;i++)
+  {
+    if(strcasecmp(dlog_module_names[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+//returns name of module
+const char *dlog_module_name(t_dlog_module module)
+{
+  return (module>=0 && module<DLOG_MODULE_COUNT) ? dlog_module_names[module] : "?";
+}
+
+//renders levels of all modules, returns length
+size_t dlog_render_levels(char *buf, size_t size)
+{
+  size_t len=0;
+  uint8_t level;
+
+  if(size == 0) return 0;
+  buf[0]=0;
+  for(int i=0;i<DLOG_MODULE_COUNT && len<size;i++)
+  {
+    level=atomic_load(&dlog_levels[i]);
+    len+=snprintf(buf+len, size-len, "%s%s=%s", i ? " " : "", dlog_module_names[i],
+      level<=ESP_LOG_VERBOSE ? dlog_level_names[level] : "?");
+  }
+  return len<size ? len : size-1;
+}
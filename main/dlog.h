@@ -0,0 +1,85 @@
+#ifndef __DLOG_H
+#define __DLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include <esp_err.h>
+#include <esp_log.h>
+
+//deferred log, hot paths store format pointer and arguments into lock-free ring
+//low priority task formats and prints records later, so callers never wait for UART
+//usable from any task or ISR
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//max number of arguments of one record
+#define DLOG_ARGS_MAX 4
+
+//modules with their own runtime level
+typedef enum _t_dlog_module
+{
+  DLOG_BOT = 0, //gateway events and commands
+  DLOG_RELAY, //sensor changes
+  DLOG_OUTBOX, //queued messages
+  DLOG_SENDER, //delivery to channels
+  DLOG_REST, //REST requests
+  DLOG_MODULE_COUNT
+} t_dlog_module;
+
+//runtime levels of modules, read by DLOG macros
+extern _Atomic uint8_t dlog_levels[DLOG_MODULE_COUNT];
+
+//starts task printing records, records written before are dropped
+esp_err_t dlog_start(void);
+
+//stores record, args are DLOG_ARGS_MAX at most, use DLOG macros instead
+void dlog_write(t_dlog_module module, esp_log_level_t level, const char *fmt, const intptr_t *args, int nargs);
+
+//sets runtime level of module
+void dlog_level_set(t_dlog_module module, esp_log_level_t level);
+
+//returns module by name, -1 when there is none
+int dlog_module_find(const char *name);
+
+//returns name of module
+const char *dlog_module_name(t_dlog_module module);
+
+//renders levels of all modules, returns length
+size_t dlog_render_levels(char *buf, size_t size);
+
+//formats record, supports %d %i %u %x %X %c %s %p %% with flags '-' '0' and width
+size_t dlog_format(char *buf, size_t size, const char *fmt, const intptr_t *args, int nargs);
+
+//returns whether level of module is enabled
+static inline int dlog_enabled(t_dlog_module module, esp_log_level_t level)
+{
+  return level <= atomic_load_explicit(&dlog_levels[module], memory_order_relaxed);
+}
+
+//argument that is a string, it must stay valid (literal or static storage), record keeps pointer only
+#define DLOG_S(s) ((intptr_t)(const char *)(s))
+
+//format must be a literal, numeric arguments are stored as intptr_t (use int, not 64-bit values)
+#define DLOG(module, level, fmt, ...) do { \
+    if (dlog_enabled(module, level)) \
+    { \
+      const intptr_t dlog_args_[] = {0, ##__VA_ARGS__}; \
+      _Static_assert(sizeof(dlog_args_) / sizeof(dlog_args_[0]) <= DLOG_ARGS_MAX + 1, "too many dlog arguments"); \
+      dlog_write(module, level, fmt, dlog_args_ + 1, sizeof(dlog_args_) / sizeof(dlog_args_[0]) - 1); \
+    } \
+  } while (0)
+
+#define DLOGE(module, fmt, ...) DLOG(module, ESP_LOG_ERROR, fmt, ##__VA_ARGS__)
+#define DLOGW(module, fmt, ...) DLOG(module, ESP_LOG_WARN, fmt, ##__VA_ARGS__)
+#define DLOGI(module, fmt, ...) DLOG(module, ESP_LOG_INFO, fmt, ##__VA_ARGS__)
+#define DLOGD(module, fmt, ...) DLOG(module, ESP_LOG_DEBUG, fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
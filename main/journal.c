@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_timer.h"
+
+#include "dib_clock.h"
+#include "journal.h"
+
+static const char *TAG = "journal";
+
+#define JOURNAL_NAMESPACE "journal"
+
+//number of records kept, older ones are overwritten
+#ifndef JOURNAL_SLOTS
+#define JOURNAL_SLOTS 32
+#endif
+
+//record packed into u64: seq(32) | boot(5) | sensor(3) | level(1) | uptime seconds(23)
+#define JOURNAL_SEQ(r) ((uint32_t)((r)>>32))
+#define JOURNAL_BOOT(r) ((uint8_t)(((r)>>27)&JOURNAL_BOOT_MASK))
+#define JOURNAL_SENSOR(r) ((int)(((r)>>24)&7))
+#define JOURNAL_LEVEL(r) ((int)(((r)>>23)&1))
+#define JOURNAL_TIME(r) ((uint32_t)((r)&0x7FFFFF))
+#define JOURNAL_TIME_MAX 0x7FFFFF
+#define JOURNAL_BOOT_MASK 0x1F
+
+//appended records reach NVS this much later, batched in one write burst and commit
+//flash write or page erase then stalls esp_timer task instead of relay task
+//changes of last JOURNAL_FLUSH_MS are lost when power is cut
+#define JOURNAL_FLUSH_MS 500
+//failed flush keeps records dirty and tries again this much later
+#define JOURNAL_RETRY_MS 5000
+
+//layout of records in NVS, stored under "format" key, records of other layouts are converted on init
+//1 - seq(32) | boot(8) | level(1) | uptime seconds(23), there was no "format" key
+#define JOURNAL_FORMAT 2
+
+
+static SemaphoreHandle_t journal_lock; //guards RAM copy, held for few instructions only
+static SemaphoreHandle_t journal_nvs_lock; //serializes NVS writes of flush and clear
+static esp_timer_handle_t journal_flush_timer;
+static nvs_handle_t journal_nvs;
+static uint8_t journal_boot; //boot counter, tells whether record is from this run
+static uint32_t journal_base; //sequence number of first record after last clear
+static uint32_t journal_next; //sequence number of next record
+static uint64_t journal_records[JOURNAL_SLOTS]; //RAM copy, record at seq % JOURNAL_SLOTS
+static uint8_t journal_valid[JOURNAL_SLOTS];
+static uint8_t journal_dirty[JOURNAL_SLOTS]; //record is not in NVS yet
+
+//helper, NVS key of slot
+static void journal_key(char *key, size_t size, unsigned int slot)
+{
+  snprintf(key, size, "e%02u", slot);
+}
+
+//helper, converts record of older format to current one, returns 0 when it cannot be converted
+static int journal_convert(uint32_t format, uint64_t *rec)
+{
+  uint64_t r=*rec;
+
+  if(format == JOURNAL_FORMAT) return 1;
+  if(format != 1) return 0;
+
+  //single door was sensor 0
+  *rec=(r&0xFFFFFFFF00000000ULL) | ((uint64_t)((r>>24)&JOURNAL_BOOT_MASK)<<27) | (r&0xFFFFFF);
+  return 1;
+}
+
+//writes appended records to NVS
+//runs in esp_timer task
+static void journal_flush(void *arg)
+{
+  uint64_t records[JOURNAL_SLOTS];
+  uint8_t dirty[JOURNAL_SLOTS];
+  char key[8];
+  esp_err_t r=ESP_OK;
+  int n=0;
+
+  xSemaphoreTake(journal_nvs_lock, portMAX_DELAY);
+
+  //take snapshot, relay task appends on meanwhile, records stay dirty until commit succeeds
+  xSemaphoreTake(journal_lock, portMAX_DELAY);
+  memcpy(records, journal_records, sizeof(records));
+  memcpy(dirty, journal_dirty, sizeof(dirty));
+  xSemaphoreGive(journal_lock);
+
+  //NVS writes entries to new place every time, so it levels wear by itself
+  for(unsigned int i=0;i<JOURNAL_SLOTS;i++)
+  {
+    if(!dirty[i]) continue;
+    journal_key(key, sizeof(key), i);
+    if(r == ESP_OK) r=nvs_set_u64(journal_nvs, key, records[i]);
+    n++;
+  }
+  if(r == ESP_OK && n) r=nvs_commit(journal_nvs);
+
+  if(r == ESP_OK)
+  {
+    //slot appended again meanwhile holds newer record, it waits for next flush
+    xSemaphoreTake(journal_lock, portMAX_DELAY);
+    for(unsigned int i=0;i<JOURNAL_SLOTS;i++)
+    {
+      if(dirty[i] && journal_records[i] == records[i]) journal_dirty[i]=0;
+    }
+    xSemaphoreGive(journal_lock);
+  }
+
+  xSemaphoreGive(journal_nvs_lock);
+
+  if(r!=ESP_OK)
+  {
+    ESP_LOGE(TAG, "Error 0x%x writing %d records, retrying in %d ms", r, n, JOURNAL_RETRY_MS);
+    esp_timer_start_once(journal_flush_timer, JOURNAL_RETRY_MS*1000ULL);
+  }
+}
+
+//opens journal of door changes kept in NVS, it survives reboot
+esp_err_t journal_init(void)
+{
+  esp_err_t r;
+  uint32_t boot=0, format=1;
+  char key[8];
+
+  if(journal_lock) return ESP_OK;
+
+  journal_lock=xSemaphoreCreateMutex();
+  journal_nvs_lock=xSemaphoreCreateMutex();
+  if(journal_lock == NULL || journal_nvs_lock == NULL) return ESP_ERR_NO_MEM;
+
+  const esp_timer_create_args_t flush_args = {
+    .callback = journal_flush,
+    .name = "journal_flush",
+  };
+  r=esp_timer_create(&flush_args, &journal_flush_timer);
+  if(r!=ESP_OK) return r;
+
+  r=nvs_open(JOURNAL_NAMESPACE, NVS_READWRITE, &journal_nvs);
+  if(r!=ESP_OK)
+  {
+    ESP_LOGE(TAG, "Error 0x%x opening NVS", r);
+    return r;
+  }
+
+  nvs_get_u32(journal_nvs, "boot", &boot);
+  journal_boot=(uint8_t)((boot+1)&JOURNAL_BOOT_MASK);
+  nvs_set_u32(journal_nvs, "boot", journal_boot);
+
+  nvs_get_u32(journal_nvs, "base", &journal_base);
+  journal_next=journal_base;
+  nvs_get_u32(journal_nvs, "format", &format);
+
+  //load records, newest one tells where to continue
+  for(unsigned int i=0;i<JOURNAL_SLOTS;i++)
+  {
+    journal_key(key, sizeof(key), i);
+    if(nvs_get_u64(journal_nvs, key, &journal_records[i]) != ESP_OK) continue;
+
+    if(!journal_convert(format, &journal_records[i]))
+    {
+      //unknown layout would decode into nonsense
+      nvs_erase_key(journal_nvs, key);
+      continue;
+    }
+    if(format!=JOURNAL_FORMAT) nvs_set_u64(journal_nvs, key, journal_records[i]);
+
+    if((int32_t)(JOURNAL_SEQ(journal_records[i])-journal_base)>=0)
+    {
+      journal_valid[i]=1;
+      if((int32_t)(JOURNAL_SEQ(journal_records[i])-journal_next)>=0) journal_next=JOURNAL_SEQ(journal_records[i])+1;
+    }
+  }
+  if(format!=JOURNAL_FORMAT)
+  {
+    ESP_LOGI(TAG, "Records of format %u converted to %u", (unsigned int)format, JOURNAL_FORMAT);
+    nvs_set_u32(journal_nvs, "format", JOURNAL_FORMAT);
+  }
+  nvs_commit(journal_nvs);
+
+  ESP_LOGI(TAG, "Boot %u, %d records waiting", journal_boot, journal_count());
+  return ESP_OK;
+}
+
+//appends door change (sensor index, level after edge, dib_clock time of edge in us)
+//record is stored in RAM, it reaches NVS within JOURNAL_FLUSH_MS together with following ones
+esp_err_t journal_append(int sensor, int level, int64_t edge_time)
+{
+  uint64_t rec;
+  uint32_t t=(uint32_t)(edge_time/1000000);
+  unsigned int slot;
+
+  if(journal_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  if(t>JOURNAL_TIME_MAX) t=JOURNAL_TIME_MAX;
+
+  xSemaphoreTake(journal_lock, portMAX_DELAY);
+
+  rec=((uint64_t)journal_next<<32) | ((uint64_t)journal_boot<<27) | ((uint64_t)(sensor&7)<<24) | ((uint64_t)(!!level)<<23) | t;
+  slot=journal_next%JOURNAL_SLOTS;
+
+  journal_records[slot]=rec;
+  journal_valid[slot]=1;
+  journal_dirty[slot]=1;
+  journal_next++;
+
+  xSemaphoreGive(journal_lock);
+
+  //first record of burst arms flush, it fails harmlessly when timer is already armed
+  esp_timer_start_once(journal_flush_timer, JOURNAL_FLUSH_MS*1000ULL);
+  return ESP_OK;
+}
+
+//returns number of records in journal
+int journal_count(void)
+{
+  int n=0;
+
+  for(unsigned int i=0;i<JOURNAL_SLOTS;i++) n+=journal_valid[i];
+  return n;
+}
+
+//renders summary of journaled changes into text (JOURNAL_SUMMARY_SIZE is enough), returns 0 when journal is empty
+//sensor_name gives name of sensor index, last_seq receives sequence number of the newest record covered by summary
+size_t journal_summary(char *text, size_t size, const char *(*sensor_name)(int sensor), uint32_t *last_seq)
+{
+  size_t len;
+  uint32_t seq, first, total;
+  uint64_t rec;
+  int opened=0, closed=0, lines=0, count;
+  uint32_t now=(uint32_t)(dib_clock_us()/1000000);
+
+  if(journal_lock == NULL || size == 0) return 0;
+
+  xSemaphoreTake(journal_lock, portMAX_DELAY);
+
+  count=journal_count();
+  if(count == 0)
+  {
+    xSemaphoreGive(journal_lock);
+    return 0;
+  }
+
+  //records that survived in ring, older ones were overwritten
+  total=journal_next-journal_base;
+  first=journal_next-(total>JOURNAL_SLOTS ? JOURNAL_SLOTS : total);
+
+  for(seq=first;seq!=journal_next;seq++)
+  {
+    if(!journal_valid[seq%JOURNAL_SLOTS]) continue;
+    if(JOURNAL_LEVEL(journal_records[seq%JOURNAL_SLOTS])) opened++; else closed++;
+  }
+
+  len=snprintf(text, size, "While offline sensors opened %dx and closed %dx", opened, closed);
+  if(total>(uint32_t)count) len+=snprintf(text+len, size-len, " (%u older changes lost)", (unsigned int)(total-count));
+  len+=snprintf(text+len, size-len, ":");
+  if(len>=size) len=size-1;
+
+  //newest changes are the interesting ones
+  for(seq=journal_next;seq!=first && lines<JOURNAL_SUMMARY_LINES;)
+  {
+    seq--;
+    if(!journal_valid[seq%JOURNAL_SLOTS]) continue;
+    rec=journal_records[seq%JOURNAL_SLOTS];
+    if(JOURNAL_BOOT(rec) == journal_boot)
+    {
+      len+=snprintf(text+len, size-len, "\n- %s %s %u s ago", sensor_name(JOURNAL_SENSOR(rec)), JOURNAL_LEVEL(rec) ? "opened" : "closed",
+        (unsigned int)(now-JOURNAL_TIME(rec)));
+    }
+    else
+    {
+      len+=snprintf(text+len, size-len, "\n- %s %s before restart", sensor_name(JOURNAL_SENSOR(rec)), JOURNAL_LEVEL(rec) ? "opened" : "closed");
+    }
+    if(len>=size) len=size-1;
+    lines++;
+  }
+
+  *last_seq=journal_next-1;
+
+  xSemaphoreGive(journal_lock);
+  return len;
+}
+
+//removes records up to last_seq (the ones covered by sent summary)
+esp_err_t journal_clear(uint32_t last_seq)
+{
+  char key[8];
+  unsigned int slot;
+  uint8_t erase[JOURNAL_SLOTS];
+
+  if(journal_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  //flush does not write records being erased, see journal_dirty
+  xSemaphoreTake(journal_nvs_lock, portMAX_DELAY);
+
+  xSemaphoreTake(journal_lock, portMAX_DELAY);
+  for(slot=0;slot<JOURNAL_SLOTS;slot++)
+  {
+    erase[slot]=journal_valid[slot] && (int32_t)(JOURNAL_SEQ(journal_records[slot])-last_seq)<=0;
+    if(erase[slot])
+    {
+      journal_valid[slot]=0;
+      journal_dirty[slot]=0;
+    }
+  }
+  journal_base=last_seq+1;
+  xSemaphoreGive(journal_lock);
+
+  for(slot=0;slot<JOURNAL_SLOTS;slot++)
+  {
+    if(!erase[slot]) continue;
+    journal_key(key, sizeof(key), slot);
+    nvs_erase_key(journal_nvs, key);
+  }
+  nvs_set_u32(journal_nvs, "base", last_seq+1);
+  nvs_commit(journal_nvs);
+
+  xSemaphoreGive(journal_nvs_lock);
+  return ESP_OK;
+}
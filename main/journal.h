@@ -0,0 +1,39 @@
+#ifndef __JOURNAL_H
+#define __JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//summary lists at most this many changes, the rest is counted only
+#define JOURNAL_SUMMARY_LINES 10
+//buffer for summary that is never truncated (sensor names are up to 15 chars)
+#define JOURNAL_SUMMARY_SIZE (64+JOURNAL_SUMMARY_LINES*64)
+
+//opens journal of door changes kept in NVS, it survives reboot
+esp_err_t journal_init(void);
+
+//appends door change (sensor index, level after edge, dib_clock time of edge in us)
+//it does not touch flash, records are written to NVS in batches shortly after
+esp_err_t journal_append(int sensor, int level, int64_t edge_time);
+
+//returns number of records in journal
+int journal_count(void);
+
+//renders summary of journaled changes into text (JOURNAL_SUMMARY_SIZE is enough), returns 0 when journal is empty
+//sensor_name gives name of sensor index, last_seq receives sequence number of the newest record covered by summary
+size_t journal_summary(char *text, size_t size, const char *(*sensor_name)(int sensor), uint32_t *last_seq);
+
+//removes records up to last_seq (the ones covered by sent summary)
+esp_err_t journal_clear(uint32_t last_seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
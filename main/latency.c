@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "latency.h"
+
+//histograms have fixed buckets, so recording is a few compares and one atomic add
+//sender task records, bot command and console read, reader may see sample that is being added
+
+//upper bounds of buckets in us, 1-2-5 steps from 1 ms to 10 s
+static const int64_t latency_bounds[LATENCY_BUCKETS-1]={
+  1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+  1000000, 2000000, 5000000, 10000000
+};
+
+static const char *const latency_names[LATENCY_STAGE_COUNT]={
+  [LATENCY_DEBOUNCE] = "debounce",
+  [LATENCY_RELAY] = "relay",
+  [LATENCY_QUEUE] = "queue",
+  [LATENCY_HTTP] = "http",
+  [LATENCY_TOTAL] = "total",
+  [LATENCY_REQUEST] = "request",
+};
+
+typedef struct _t_latency_hist
+{
+  atomic_uint buckets[LATENCY_BUCKETS];
+  atomic_uint count;
+  _Atomic int64_t max; //us
+} t_latency_hist;
+
+static t_latency_hist latency_hists[LATENCY_STAGE_COUNT];
+
+//adds sample in us to histogram of stage, negative samples are ignored
+void latency_record(t_latency_stage stage, int64_t us)
+{
+  t_latency_hist *h;
+  int b;
+
+  if((unsigned)stage>=LATENCY_STAGE_COUNT || us<0) return;
+  h=&latency_hists[stage];
+
+  for(b=0;b<LATENCY_BUCKETS-1 && us>=latency_bounds[b];b++);
+
+  atomic_fetch_add_explicit(&h->buckets[b], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+  if(us>atomic_load_explicit(&h->max, memory_order_relaxed)) atomic_store_explicit(&h->max, us, memory_order_relaxed);
+}
+
+//clears all histograms
+void latency_reset(void)
+{
+  for(int s=0;s<LATENCY_STAGE_COUNT;s++)
+  {
+    for(int b=0;b<LATENCY_BUCKETS;b++) atomic_store(&latency_hists[s].buckets[b], 0);
+    atomic_store(&latency_hists[s].count, 0);
+    atomic_store(&latency_hists[s].max, 0);
+  }
+}
+
+//helper, returns bucket where per mille of samples is reached
+static int latency_percentile(const t_latency_hist *h, unsigned int count, unsigned int per_mille)
+{
+  unsigned int need=(unsigned int)(((uint64_t)count*per_mille+999)/1000), seen=0;
+  int b;
+
+  for(b=0;b<LATENCY_BUCKETS-1;b++)
+  {
+    seen+=atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+    if(seen>=need) break;
+  }
+  return b;
+}
+
+//helper, renders bucket bound as "<5ms", 24 bytes fit any int64 bound
+static int latency_bound(char *buf, size_t size, int bucket)
+{
+  if(bucket>=LATENCY_BUCKETS-1) return snprintf(buf, size, ">=%lldms", (long long)(latency_bounds[LATENCY_BUCKETS-2]/1000));
+  return snprintf(buf, size, "<%lldms", (long long)(latency_bounds[bucket]/1000));
+}
+
+//renders count, p50, p99 and max of every stage, one line per stage, returns length
+size_t latency_render(char *buf, size_t size)
+{
+  char p50[24], p99[24];
+  size_t len=0;
+  unsigned int count;
+  const t_latency_hist *h;
+
+  if(size == 0) return 0;
+  buf[0]=0;
+
+  for(int s=0;s<LATENCY_STAGE_COUNT && len<size;s++)
+  {
+    h=&latency_hists[s];
+    count=atomic_load_explicit(&h->count, memory_order_relaxed);
+    if(count == 0)
+    {
+      len+=snprintf(buf+len, size-len, "%s%s n=0", len ? "\n" : "", latency_names[s]);
+      continue;
+    }
+    latency_bound(p50, sizeof(p50), latency_percentile(h, count, 500));
+    latency_bound(p99, sizeof(p99), latency_percentile(h, count, 990));
+    len+=snprintf(buf+len, size-len, "%s%s n=%u p50%s p99%s max=%lldms", len ? "\n" : "", latency_names[s],
+      count, p50, p99, (long long)(atomic_load_explicit(&h->max, memory_order_relaxed)/1000));
+  }
+  return len<size ? len : size-1;
+}
+
+//renders all buckets of stage, one line per nonempty bucket, returns length
+size_t latency_render_histogram(t_latency_stage stage, char *buf, size_t size)
+{
+  char bound[24];
+  size_t len=0;
+  unsigned int n;
+
+  if(size == 0) return 0;
+  buf[0]=0;
+  if((unsigned)stage>=LATENCY_STAGE_COUNT) return 0;
+
+  for(int b=0;b<LATENCY_BUCKETS && len<size;b++)
+  {
+    n=atomic_load_explicit(&latency_hists[stage].buckets[b], memory_order_relaxed);
+    if(n == 0) continue;
+    latency_bound(bound, sizeof(bound), b);
+    len+=snprintf(buf+len, size-len, "%s%-9s %u", len ? "\n" : "", bound, n);
+  }
+  return len<size ? len : size-1;
+}
+
+//returns short name of stage
+const char *latency_stage_name(t_latency_stage stage)
+{
+  if((unsigned)stage>=LATENCY_STAGE_COUNT) return "?";
+  return latency_names[stage];
+}
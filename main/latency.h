@@ -0,0 +1,45 @@
+#ifndef __LATENCY_H
+#define __LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//stages of door notification, from relay edge to HTTP response
+typedef enum _t_latency_stage
+{
+  LATENCY_DEBOUNCE = 0, //edge captured by ISR -> change confirmed by debounce
+  LATENCY_RELAY, //change confirmed -> queued to outbox
+  LATENCY_QUEUE, //queued -> request started by sender
+  LATENCY_HTTP, //request started -> response headers received (TLS and Discord)
+  LATENCY_TOTAL, //edge -> response headers received
+  LATENCY_REQUEST, //edge -> request started, does not depend on Discord, it is compared across releases
+  LATENCY_STAGE_COUNT
+} t_latency_stage;
+
+//number of histogram buckets, the last one collects everything above the biggest bound
+#define LATENCY_BUCKETS 14
+
+//adds sample in us to histogram of stage, negative samples are ignored
+void latency_record(t_latency_stage stage, int64_t us);
+
+//clears all histograms
+void latency_reset(void);
+
+//renders count, p50, p99 and max of every stage, one line per stage, returns length
+size_t latency_render(char *buf, size_t size);
+
+//renders all buckets of stage, one line per nonempty bucket, returns length
+size_t latency_render_histogram(t_latency_stage stage, char *buf, size_t size);
+
+//returns short name of stage
+const char *latency_stage_name(t_latency_stage stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
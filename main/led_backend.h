@@ -0,0 +1,48 @@
+#ifndef __LED_BACKEND_H
+#define __LED_BACKEND_H
+
+#include "led_pattern.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//one LED output as seen by backend
+typedef struct _t_led_output
+{
+  unsigned int gpio; //led gpio
+  int on_state; //led light on level
+  void *hw; //backend private data
+} t_led_output;
+
+//backend drives LED output, LED task only decides what to show
+//interface has no ESP-IDF types, results are 0 on success or error code (esp_err_t of device backends)
+typedef struct _t_led_backend
+{
+  const char *name;
+  //prepares output and switches led off, returns 0 on success
+  int (*init)(t_led_output *out);
+  //lights (on!=0) or darkens led
+  void (*set)(t_led_output *out, int on);
+  //plays pattern forever without CPU, NULL when backend cannot do it
+  //returns 0 only when hardware took over the output
+  int (*play)(t_led_output *out, const t_led_pattern *pattern);
+  //stops pattern started by play, output is dark afterwards
+  void (*stop)(t_led_output *out);
+  //releases output
+  void (*deinit)(t_led_output *out);
+} t_led_backend;
+
+//software backend, every edge is gpio_set_level called by LED task
+extern const t_led_backend led_backend_gpio;
+
+#ifdef CONFIG_LED_BACKEND_RMT
+//periodic patterns are played by RMT peripheral, falls back to gpio otherwise
+extern const t_led_backend led_backend_rmt;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include "driver/gpio.h"
+
+#include "led_backend.h"
+
+static const char *TAG = "led_backend_gpio";
+
+static int led_gpio_init(t_led_output *out)
+{
+  esp_err_t r;
+
+  gpio_config_t io_conf = {
+      .intr_type = GPIO_INTR_DISABLE,
+      .mode = GPIO_MODE_OUTPUT,
+      .pin_bit_mask = BIT64(out->gpio),
+      .pull_down_en = 0,
+      .pull_up_en = 0
+    };
+
+  r = gpio_config(&io_conf);
+  if(r!=ESP_OK)
+  {
+    ESP_LOGE(TAG, "Error 0x%x initializing GPIO %u",r,out->gpio);
+    return r;
+  } 
+
+  r=gpio_set_level(out->gpio, !out->on_state);
+  if(r!=ESP_OK)
+  {
+    ESP_LOGE(TAG, "Error 0x%x setting GPIO %u level",r, out->gpio);
+  }
+
+  return ESP_OK;
+}
+
+static void led_gpio_set(t_led_output *out, int on)
+{
+  gpio_set_level(out->gpio, !out->on_state ^ !!on);
+}
+
+static void led_gpio_deinit(t_led_output *out)
+{
+  gpio_set_level(out->gpio, !out->on_state);
+}
+
+const t_led_backend led_backend_gpio = {
+  .name = "gpio",
+  .init = led_gpio_init,
+  .set = led_gpio_set,
+  .play = NULL,
+  .stop = NULL,
+  .deinit = led_gpio_deinit,
+};
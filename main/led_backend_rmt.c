@@ -0,0 +1,184 @@
+#include <stdlib.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "soc/soc_caps.h"
+
+#include "driver/gpio.h"
+#include "driver/rmt_tx.h"
+
+#include "led_backend.h"
+
+#ifdef CONFIG_LED_BACKEND_RMT
+
+static const char *TAG = "led_backend_rmt";
+
+//RMT tick is 2.5us, low enough for 80MHz and 40MHz clock sources (divider <= 256)
+#define LED_RMT_RESOLUTION_HZ 400000
+#define LED_RMT_TICKS_PER_MS (LED_RMT_RESOLUTION_HZ/1000)
+//longest half-symbol, RMT duration has 15 bits
+#define LED_RMT_CHUNK_MS 80
+
+//whole looped pattern must fit into channel memory
+#define LED_RMT_SYMBOLS SOC_RMT_MEM_WORDS_PER_CHANNEL
+
+typedef struct _t_led_rmt
+{
+  rmt_channel_handle_t chan;
+  rmt_encoder_handle_t enc;
+  rmt_symbol_word_t symbols[LED_RMT_SYMBOLS]; //must stay valid while pattern is played
+} t_led_rmt;
+
+//helper, converts pattern into RMT symbols, every segment is split into chunks fitting 15 bit duration
+//returns number of symbols, 0 when pattern does not fit
+static size_t led_rmt_encode(const t_led_pattern *pattern, int on_state, rmt_symbol_word_t *symbols)
+{
+  size_t halves=0;
+  uint32_t ms, chunk, ticks;
+  int level;
+
+  for(uint16_t i=0;i<pattern->count;i++)
+  {
+    level=!on_state ^ !!pattern->segments[i].on;
+    ms=pattern->segments[i].duration;
+    while(ms)
+    {
+      chunk=ms>LED_RMT_CHUNK_MS ? LED_RMT_CHUNK_MS : ms;
+      //do not leave too short remainder
+      if(ms>LED_RMT_CHUNK_MS && ms-chunk<LED_RMT_CHUNK_MS/2) chunk=ms/2;
+      ms-=chunk;
+
+      if(halves/2>=LED_RMT_SYMBOLS) return 0;
+      ticks=chunk*LED_RMT_TICKS_PER_MS;
+      if(halves&1)
+      {
+        symbols[halves/2].duration1=ticks;
+        symbols[halves/2].level1=level;
+      }
+      else
+      {
+        symbols[halves/2].duration0=ticks;
+        symbols[halves/2].level0=level;
+      }
+      halves++;
+    }
+  }
+
+  if(halves&1)
+  {
+    //zero duration would end the loop, split last half into two
+    ticks=symbols[halves/2].duration0;
+    symbols[halves/2].duration0=ticks/2;
+    symbols[halves/2].duration1=ticks-ticks/2;
+    symbols[halves/2].level1=symbols[halves/2].level0;
+    halves++;
+  }
+
+  return halves/2;
+}
+
+static int led_rmt_init(t_led_output *out)
+{
+  out->hw=NULL;
+  return led_backend_gpio.init(out);
+}
+
+static void led_rmt_set(t_led_output *out, int on)
+{
+  led_backend_gpio.set(out, on);
+}
+
+static void led_rmt_stop(t_led_output *out)
+{
+  t_led_rmt *rmt=(t_led_rmt *)out->hw;
+
+  if(rmt == NULL) return;
+
+  rmt_disable(rmt->chan);
+  rmt_del_channel(rmt->chan);
+  rmt_del_encoder(rmt->enc);
+  free(rmt);
+  out->hw=NULL;
+
+  //RMT has released the pin, take it back
+  led_backend_gpio.init(out);
+}
+
+static int led_rmt_play(t_led_output *out, const t_led_pattern *pattern)
+{
+  esp_err_t r;
+  size_t count;
+  t_led_rmt *rmt;
+
+  led_rmt_stop(out);
+
+  rmt=(t_led_rmt *)calloc(1, sizeof(t_led_rmt));
+  if(rmt == NULL) return ESP_ERR_NO_MEM;
+
+  count=led_rmt_encode(pattern, out->on_state, rmt->symbols);
+  if(count == 0)
+  {
+    free(rmt);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  rmt_tx_channel_config_t chan_cfg = {
+    .gpio_num = out->gpio,
+    .clk_src = RMT_CLK_SRC_DEFAULT,
+    .resolution_hz = LED_RMT_RESOLUTION_HZ,
+    .mem_block_symbols = LED_RMT_SYMBOLS,
+    .trans_queue_depth = 1,
+  };
+  rmt_copy_encoder_config_t enc_cfg = {};
+  rmt_transmit_config_t tx_cfg = {
+    .loop_count = -1, //forever
+    .flags.eot_level = !out->on_state,
+  };
+
+  r=rmt_new_tx_channel(&chan_cfg, &rmt->chan);
+  if(r!=ESP_OK) goto FNRET;
+
+  r=rmt_new_copy_encoder(&enc_cfg, &rmt->enc);
+  if(r!=ESP_OK) goto FNRET;
+
+  r=rmt_enable(rmt->chan);
+  if(r!=ESP_OK) goto FNRET;
+
+  r=rmt_transmit(rmt->chan, rmt->enc, rmt->symbols, count*sizeof(rmt_symbol_word_t), &tx_cfg);
+  if(r!=ESP_OK) goto FNRET;
+
+  out->hw=rmt;
+
+FNRET:
+  if(r!=ESP_OK)
+  {
+    //no free channel or pattern is not supported, LED task stays in charge
+    ESP_LOGW(TAG, "Error 0x%x playing pattern on GPIO %u, using software", r, out->gpio);
+    if(rmt->chan)
+    {
+      rmt_disable(rmt->chan);
+      rmt_del_channel(rmt->chan);
+    }
+    if(rmt->enc) rmt_del_encoder(rmt->enc);
+    free(rmt);
+    led_backend_gpio.init(out);
+  }
+  return r;
+}
+
+static void led_rmt_deinit(t_led_output *out)
+{
+  led_rmt_stop(out);
+  led_backend_gpio.deinit(out);
+}
+
+const t_led_backend led_backend_rmt = {
+  .name = "rmt",
+  .init = led_rmt_init,
+  .set = led_rmt_set,
+  .play = led_rmt_play,
+  .stop = led_rmt_stop,
+  .deinit = led_rmt_deinit,
+};
+
+#endif
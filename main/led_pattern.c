@@ -0,0 +1,83 @@
+#include <stddef.h>
+
+#include "led_pattern.h"
+
+//pattern tables are const, so they are stored in flash
+
+#define LED_ON_TIME 100
+#define LED_OFF_TIME_ANGRY (LED_ON_TIME)
+#define LED_OFF_TIME_SLOW 1900
+#define LED_OFF_TIME_ONCE 400 
+
+//morse timing for SOS
+#define LED_SOS_DOT 150
+#define LED_SOS_DASH (3*LED_SOS_DOT)
+#define LED_SOS_GAP (LED_SOS_DOT)
+#define LED_SOS_LETTER_GAP (3*LED_SOS_DOT)
+#define LED_SOS_WORD_GAP (7*LED_SOS_DOT)
+
+#define SEG_ON(ms) {1, (ms)}
+#define SEG_OFF(ms) {0, (ms)}
+
+#define LED_PATTERN(segs) {(segs), sizeof(segs)/sizeof((segs)[0])}
+
+static const t_led_segment led_off[]={ SEG_OFF(0) };
+static const t_led_segment led_on[]={ SEG_ON(0) };
+static const t_led_segment led_slowly[]={ SEG_ON(LED_ON_TIME), SEG_OFF(LED_OFF_TIME_SLOW) };
+static const t_led_segment led_angry[]={ SEG_ON(LED_ON_TIME), SEG_OFF(LED_OFF_TIME_ANGRY) };
+static const t_led_segment led_once[]={ SEG_ON(LED_ON_TIME), SEG_OFF(LED_OFF_TIME_ONCE) };
+static const t_led_segment led_double[]={
+  SEG_ON(LED_ON_TIME), SEG_OFF(LED_ON_TIME),
+  SEG_ON(LED_ON_TIME), SEG_OFF(LED_OFF_TIME_SLOW-2*LED_ON_TIME)
+};
+static const t_led_segment led_sos[]={
+  SEG_ON(LED_SOS_DOT), SEG_OFF(LED_SOS_GAP), SEG_ON(LED_SOS_DOT), SEG_OFF(LED_SOS_GAP), SEG_ON(LED_SOS_DOT), SEG_OFF(LED_SOS_LETTER_GAP),
+  SEG_ON(LED_SOS_DASH), SEG_OFF(LED_SOS_GAP), SEG_ON(LED_SOS_DASH), SEG_OFF(LED_SOS_GAP), SEG_ON(LED_SOS_DASH), SEG_OFF(LED_SOS_LETTER_GAP),
+  SEG_ON(LED_SOS_DOT), SEG_OFF(LED_SOS_GAP), SEG_ON(LED_SOS_DOT), SEG_OFF(LED_SOS_GAP), SEG_ON(LED_SOS_DOT), SEG_OFF(LED_SOS_WORD_GAP)
+};
+
+//indexed by t_led_action
+static const t_led_pattern led_patterns[]={
+  [LED_OFF]=LED_PATTERN(led_off),
+  [LED_BLINKING_SLOWLY]=LED_PATTERN(led_slowly),
+  [LED_BLINKING_ANGRY]=LED_PATTERN(led_angry),
+  [LED_BLINK_ONCE]=LED_PATTERN(led_once),
+  [LED_ON]=LED_PATTERN(led_on),
+  [LED_DOUBLE_BLINK]=LED_PATTERN(led_double),
+  [LED_SOS]=LED_PATTERN(led_sos),
+};
+
+_Static_assert(sizeof(led_patterns)/sizeof(led_patterns[0]) == LED_ACTION_COUNT, "every t_led_action needs its pattern");
+
+//returns pattern for action, NULL for unsupported action
+const t_led_pattern *led_pattern_get(t_led_action action)
+{
+  if((unsigned int)action>=LED_ACTION_COUNT) return NULL;
+  return &led_patterns[action];
+}
+
+//returns whether pattern holds its last state forever
+int led_pattern_is_static(const t_led_pattern *pattern)
+{
+  return pattern->segments[pattern->count-1].duration == 0;
+}
+
+//starts pattern, it is played once and then repeated repeats times (-1 for infinitely)
+void led_pattern_start(t_led_cursor *cursor, int repeats)
+{
+  cursor->segment=0;
+  cursor->repeats=repeats;
+}
+
+//moves cursor to next segment, returns segment to be shown or NULL when pattern has finished
+const t_led_segment *led_pattern_next(const t_led_pattern *pattern, t_led_cursor *cursor)
+{
+  if(cursor->segment>=pattern->count)
+  {
+    //end of pattern, play it again if there are repeats left
+    if(cursor->repeats>=0 && (--cursor->repeats)<0) return NULL;
+    cursor->segment=0;
+  }
+
+  return &pattern->segments[cursor->segment++];
+}
@@ -0,0 +1,49 @@
+#ifndef __LED_PATTERN_H
+#define __LED_PATTERN_H
+
+#include <stdint.h>
+
+#include "led_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//one step of pattern, led is lit or dark for duration ms
+typedef struct _t_led_segment
+{
+  uint16_t on; //led lit during segment
+  uint16_t duration; //duration in ms, 0 means hold until another action comes
+} t_led_segment;
+
+//pattern is a constant table of segments played in order
+typedef struct _t_led_pattern
+{
+  const t_led_segment *segments;
+  uint16_t count; //number of segments
+} t_led_pattern;
+
+//position in running pattern
+typedef struct _t_led_cursor
+{
+  uint16_t segment; //next segment to play
+  int repeats; //remaining repeats, -1 means forever
+} t_led_cursor;
+
+//returns pattern for action, NULL for unsupported action
+const t_led_pattern *led_pattern_get(t_led_action action);
+
+//returns whether pattern holds its last state forever
+int led_pattern_is_static(const t_led_pattern *pattern);
+
+//starts pattern, it is played once and then repeated repeats times (-1 for infinitely)
+void led_pattern_start(t_led_cursor *cursor, int repeats);
+
+//moves cursor to next segment, returns segment to be shown or NULL when pattern has finished
+const t_led_segment *led_pattern_next(const t_led_pattern *pattern, t_led_cursor *cursor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
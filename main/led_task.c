@@ -1,15 +1,19 @@
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <time.h>
 #include <sys/time.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_task.h"
 
-#include "driver/gpio.h"
-
+#include "dib_clock.h"
 #include "led_task.h"
+#include "led_pattern.h"
+#include "led_backend.h"
 
 static const char *TAG = "led_task";
 
@@ -18,10 +22,29 @@ static const char *TAG = "led_task";
 #define LED_ACTIONS_MAX 8
 #endif
 
-#define LED_ON_TIME 100
-#define LED_OFF_TIME_ANGRY (LED_ON_TIME)
-#define LED_OFF_TIME_SLOW 1900
-#define LED_OFF_TIME_ONCE 400 
+//size of lock-free ring passing pushed actions to led task, must be power of 2
+#ifndef LED_RING_SIZE
+#define LED_RING_SIZE 8
+#endif
+#define LED_RING_MASK (LED_RING_SIZE-1)
+
+#if (LED_RING_SIZE & LED_RING_MASK) != 0
+#error "LED_RING_SIZE must be power of 2"
+#endif
+
+//max number of outputs driven by led task
+#ifndef LED_OUTPUTS_MAX
+#define LED_OUTPUTS_MAX 8
+#endif
+
+//when task wakes up later than this after deadline, timing is restarted from now
+#define LED_LATE_MAX_MS 50
+
+//no change is planned
+#define LED_NEVER ((uint64_t)-1)
+
+//stack of led task, check its high-water mark by !stats or console before changing it
+#define LED_TASK_STACK 4096
 
 //increment list index, wrap around LED_ACTIONS_MAX
 #define INC_LED_LIST_IDX(idx) \
@@ -30,10 +53,7 @@ static const char *TAG = "led_task";
 //check pointer validity
 #define IS_LED_INVALID(led) \
   ((led) == NULL || \
-  (led)->size!=sizeof(t_led_state) || \
-  (unsigned int)((led)->list_head)>=LED_ACTIONS_MAX || \
-  (unsigned int)((led)->list_tail)>=LED_ACTIONS_MAX || \
-  (unsigned int)((led)->list_len)>LED_ACTIONS_MAX)
+  atomic_load(&(led)->size)!=sizeof(t_led_state))
 
 #define IS_LED_VALID(led) (!IS_LED_INVALID(led))
 
@@ -52,19 +72,35 @@ typedef struct _t_led_action_cell
   int repeats; //number of repeats, -1 means forever or until new action is pushed
 } t_led_action_cell;
 
+//cell of lock-free multi-producer single-consumer ring
+//seq tells whose turn it is: ==position free for producer, ==position+1 filled for consumer
+typedef struct _t_led_ring_cell
+{
+  atomic_uint seq;
+  t_led_action_cell cell;
+} t_led_ring_cell;
+
 typedef struct _t_led_running
 {
   int idx; //active index, <0 when inactive
-  int phase; //phase of active 
+  const t_led_pattern *pattern; //pattern of active action
+  t_led_cursor cursor; //position in pattern
+  int offloaded; //pattern is played by backend hardware
   uint64_t next_change; //when there will be next change needed
 } t_led_running;
 
 typedef struct _t_led_state
 {
-  size_t size; //size of structure, it is (weak) handle integrity check
-  unsigned int gpio; //led gpio
-  int on_state; //led light on level
+  atomic_size_t size; //size of structure, it is (weak) handle integrity check
+  t_led_output out; //led gpio and backend state
+
+  //pushed actions waiting for led task, written by any task or ISR without locking
+  t_led_ring_cell ring[LED_RING_SIZE];
+  atomic_uint ring_enq; //next position for producers
+  unsigned int ring_deq; //next position for consumer, owned by led task
+  atomic_uint ring_dropped; //number of actions lost because led task has not emptied ring in time
 
+  //following members are owned by led task only
   t_led_action_cell list[LED_ACTIONS_MAX]; //list of actions
   int list_head; //first empty
   int list_tail; //first to run
@@ -72,272 +108,543 @@ typedef struct _t_led_state
   int list_changed; //whether list has changed
 
   t_led_running running; //running state
-  
+  int heap_pos; //position in scheduler heap, <0 when not scheduled yet
+
+  //led task service request, set by push / init / deinit
+  atomic_int queued; //whether led is on dirty stack
+  struct _t_led_state *dirty_next; //next led on dirty stack
+
+  //teardown, producers may still be inside led_push_action when led_deinit invalidates the state
+  atomic_int users; //producers inside led_push_action, state is not freed before it drops to 0
+  int zombie; //deinitialized, waits on zombie list until users leave, owned by led task
+  struct _t_led_state *zombie_next; //next led on zombie list
+
 } t_led_state;
 
-static portMUX_TYPE spinlock = portMUX_INITIALIZER_UNLOCKED;
+//all outputs are driven by single task
+static TaskHandle_t led_task_handle;
+static atomic_int led_task_started; //0 - not started, 1 - being started, 2 - running
+static atomic_int led_outputs; //number of initialized outputs
+
+//outputs waiting for service, lock-free stack (push by anyone, taken whole by led task)
+static _Atomic(t_led_state *) led_dirty;
+
+//backend driving all outputs
+#ifdef CONFIG_LED_BACKEND_RMT
+static const t_led_backend *const led_backend=&led_backend_rmt;
+#elif defined(LED_BACKEND)
+//host build names its own backend, e.g. recording mock of tests
+extern const t_led_backend LED_BACKEND;
+static const t_led_backend *const led_backend=&LED_BACKEND;
+#else
+static const t_led_backend *const led_backend=&led_backend_gpio;
+#endif
 
-static void led_task(void *handle);
+//outputs ordered by time of next change (min-heap), owned by led task
+static t_led_state *led_heap[LED_OUTPUTS_MAX];
+static int led_heap_len;
 
-//initialize LED task on gpio with active state on_state 
-void* led_init(const unsigned int gpio, const int on_state)
+//deinitialized outputs still used by producers, owned by led task
+static t_led_state *led_zombies;
+
+static void led_task(void *arg);
+
+//monotonic time in ms
+static inline uint64_t led_now_ms(void)
 {
-  esp_err_t r;
+  return (uint64_t)(dib_clock_us()/1000);
+}
 
-  gpio_config_t io_conf = {
-      .intr_type = GPIO_INTR_DISABLE,
-      .mode = GPIO_MODE_OUTPUT,
-      .pin_bit_mask = BIT64(gpio),
-      .pull_down_en = 0,
-      .pull_up_en = 0
-    };
+//asks led task to service led, safe to be called from ISR
+static void led_notify(t_led_state *led)
+{
+  TaskHandle_t task=led_task_handle;
+  t_led_state *top;
 
+  //put led to dirty stack unless it is already there
+  if(atomic_exchange(&led->queued, 1) == 0)
+  {
+    top=atomic_load(&led_dirty);
+    do
+    {
+      led->dirty_next=top;
+    } while(!atomic_compare_exchange_weak(&led_dirty, &top, led));
+  }
 
-  ESP_LOGI(TAG, "Initializing..");
+  if(task == NULL) return;
 
-  r = gpio_config(&io_conf);
-  if(r!=ESP_OK)
+  if(xPortInIsrContext())
   {
-    ESP_LOGE(TAG, "Error 0x%x initializing GPIO %d",r,gpio);
-    return NULL;
-  } 
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+  }
+  else
+  {
+    xTaskNotifyGive(task);
+  }
+}
+
+//starts led task when it is not running yet
+static int led_task_start(void)
+{
+  int expected=0;
+
+  if(atomic_compare_exchange_strong(&led_task_started, &expected, 1))
+  {
+    if(xTaskCreate( led_task, "led_task", LED_TASK_STACK, NULL, 3, &led_task_handle )!=pdPASS)
+    {
+      ESP_LOGE(TAG, "Error creating led task");
+      atomic_store(&led_task_started, 0);
+      return 0;
+    }
+    ESP_LOGI(TAG, "Task handle is %p", led_task_handle);
+    atomic_store(&led_task_started, 2);
+  }
+
+  //somebody else is starting the task right now
+  while(atomic_load(&led_task_started) == 1)
+  {
+    vTaskDelay(1);
+  }
+
+  return atomic_load(&led_task_started) == 2;
+}
+
+//initialize LED output on gpio with active state on_state 
+void* led_init(const unsigned int gpio, const int on_state)
+{
+  int r;
 
-  r=gpio_set_level(gpio, !on_state);
-  if(r!=ESP_OK)
+  ESP_LOGI(TAG, "Initializing..");
+
+  if(!led_task_start()) return NULL;
+
+  if(atomic_fetch_add(&led_outputs, 1) >= LED_OUTPUTS_MAX)
   {
-    ESP_LOGE(TAG, "Error 0x%x setting GPIO %d level",r, gpio);
+    atomic_fetch_sub(&led_outputs, 1);
+    ESP_LOGE(TAG, "Too many outputs, LED_OUTPUTS_MAX is %d", LED_OUTPUTS_MAX);
+    return NULL;
   }
 
   t_led_state *state=(t_led_state*)calloc(1,sizeof(t_led_state));
   if(state == NULL)
   {
     ESP_LOGE(TAG, "Error getting memory for led state");
+    atomic_fetch_sub(&led_outputs, 1);
     return NULL;
   } 
 
-  state->gpio=gpio;
-  state->on_state=on_state;
-  state->running.idx=-1;
-  state->size=sizeof(t_led_state);
+  state->out.gpio=gpio;
+  state->out.on_state=on_state;
+
+  r=led_backend->init(&state->out);
+  if(r!=0)
+  {
+    ESP_LOGE(TAG, "Error 0x%x initializing %s output on GPIO %u", r, led_backend->name, gpio);
+    free(state);
+    atomic_fetch_sub(&led_outputs, 1);
+    return NULL;
+  }
 
-  TaskHandle_t xHandle = NULL;
-  xTaskCreate( led_task, "led_task", 4096, state, 3, &xHandle );
+  state->running.idx=-1;
+  state->heap_pos=-1;
+  for(unsigned int i=0;i<LED_RING_SIZE;i++)
+  {
+    atomic_init(&state->ring[i].seq, i);
+  }
+  atomic_init(&state->ring_enq, 0);
+  atomic_init(&state->ring_dropped, 0);
+  atomic_init(&state->queued, 0);
+  atomic_init(&state->users, 0);
+  atomic_init(&state->size, sizeof(t_led_state));
 
-  ESP_LOGI(TAG, "Task handle is %p", xHandle);
+  //let led task register new output
+  led_notify(state);
 
   return state;
 }
 
 
-/*
-+---+---+
-| 0 | 1 |
-+---+---+
-  ^   ^tail
-  head
-*/
-
 //push action into LED task and let it repeat repeats times (use -1 for infinitely repeating action)
+//lock-free, may be called from any task or ISR
 void led_push_action(void *handle, t_led_action led_action, int repeats)
 {
   t_led_state *led=(t_led_state *)handle; //make it easier to write references..
-  taskENTER_CRITICAL(&spinlock);
+  t_led_ring_cell *cell;
+  unsigned int pos, seq;
+  int diff;
+
+  if(led == NULL) return;
 
-  //integrity check
-  if(IS_LED_VALID(led)) {
-    if(led->list_len<LED_ACTIONS_MAX)
+  //led task does not free state while we are here, count us in before integrity check
+  atomic_fetch_add(&led->users, 1);
+  if(IS_LED_INVALID(led)) goto FNRET;
+
+  //reserve cell at ring_enq
+  pos=atomic_load_explicit(&led->ring_enq, memory_order_relaxed);
+  for(;;)
+  {
+    cell=&led->ring[pos & LED_RING_MASK];
+    seq=atomic_load_explicit(&cell->seq, memory_order_acquire);
+    diff=(int)(seq-pos);
+    if(diff==0)
     {
-      //list has space for new action, just add it
-      led->list[led->list_tail].action=led_action;
-      led->list[led->list_tail].repeats=repeats;
-      led->list_len+=1;
-      INC_LED_LIST_IDX(led->list_tail);
+      //cell is free, try to take it
+      if(atomic_compare_exchange_weak_explicit(&led->ring_enq, &pos, pos+1, memory_order_relaxed, memory_order_relaxed)) break;
+    }
+    else if(diff<0)
+    {
+      //ring is full, led task is behind
+      atomic_fetch_add_explicit(&led->ring_dropped, 1, memory_order_relaxed);
+      goto FNRET;
     }
     else
     {
-      //no more space, so move whole list, set new at the tail and finish active action
-      INC_LED_LIST_IDX(led->list_tail);
-      INC_LED_LIST_IDX(led->list_head);
-      led->list[led->list_tail].action=led_action;
-      led->list[led->list_tail].repeats=repeats;
-      led->running.idx=-1;
+      //other producer was faster
+      pos=atomic_load_explicit(&led->ring_enq, memory_order_relaxed);
     }
-    led->list_changed=1;
   }
 
-  taskEXIT_CRITICAL(&spinlock);
+  cell->cell.action=led_action;
+  cell->cell.repeats=repeats;
+  //publish cell to consumer
+  atomic_store_explicit(&cell->seq, pos+1, memory_order_release);
+
+  //wake led task, it recalculates its deadline
+  led_notify(led);
+
+FNRET:
+  atomic_fetch_sub(&led->users, 1);
+}
+
+//helper, takes one pushed action out of ring, returns 0 when ring is empty
+//called from led task only
+static int led_ring_pop(t_led_state *led, t_led_action_cell *out)
+{
+  unsigned int pos=led->ring_deq;
+  t_led_ring_cell *cell=&led->ring[pos & LED_RING_MASK];
+  unsigned int seq=atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+  if((int)(seq-(pos+1))<0) return 0; //not filled yet
+
+  *out=cell->cell;
+  //hand cell back to producers for next round
+  atomic_store_explicit(&cell->seq, pos+LED_RING_SIZE, memory_order_release);
+  led->ring_deq=pos+1;
+  return 1;
+}
+
+/*
++---+---+
+| 0 | 1 |
++---+---+
+  ^   ^tail
+  head
+*/
+
+//helper, appends pushed action to list of actions
+//called from led task only
+static void led_list_add(t_led_state *led, const t_led_action_cell *action)
+{
+  if(led->list_len<LED_ACTIONS_MAX)
+  {
+    //list has space for new action, just add it
+    led->list[led->list_tail]=*action;
+    led->list_len+=1;
+    INC_LED_LIST_IDX(led->list_tail);
+  }
+  else
+  {
+    //no more space, so move whole list, set new at the tail and finish active action
+    INC_LED_LIST_IDX(led->list_tail);
+    INC_LED_LIST_IDX(led->list_head);
+    led->list[led->list_tail]=*action;
+    led->running.idx=-1;
+  }
+  led->list_changed=1;
 }
 
 static void led_update_action(t_led_state *led, uint64_t t);
 
+//helper, returns whether action can be replaced by following one without finishing
+static int led_is_open_ended(const t_led_action_cell *cell)
+{
+  const t_led_pattern *pattern=led_pattern_get(cell->action);
+
+  return cell->repeats<0 || pattern == NULL || led_pattern_is_static(pattern);
+}
+
+//helper, removes action at led->list_head
+static void led_drop_action(t_led_state *led)
+{
+  if(led->running.idx==led->list_head) led->running.idx=-1;
+  led->list_len--;
+  INC_LED_LIST_IDX(led->list_head);
+}
+
 //helper, inits action starting at led->list_head
-//always called form critical section protected code
+//finite action that is already running continues
+//called from led task only
 static void led_init_action(t_led_state *led, uint64_t t)
 {
-  if(led == NULL || led->list_len<=0) return; //nothing to do
+  if(led == NULL) return;
+
+  led->list_changed=0;
 
-  //skip all -1 repeats until last or finite
-  while(led->list_len>1 && led->list[led->list_head].repeats<0)
+  //skip all open ended actions until last or finite
+  while(led->list_len>1 && led_is_open_ended(&led->list[led->list_head]))
   {
-    led->list_len--;
-    INC_LED_LIST_IDX(led->list_head);
+    led_drop_action(led);
+  }
+
+  if(led->list_len<=0) return; //nothing to do
+  if(led->running.idx==led->list_head) return; //let it finish
+
+  if(led->running.offloaded)
+  {
+    led_backend->stop(&led->out);
+    led->running.offloaded=0;
   }
 
   led->running.idx=led->list_head;
-  led->running.phase=0;
-  led_update_action(led,t);
+  led->running.pattern=led_pattern_get(led->list[led->list_head].action);
+  led_pattern_start(&led->running.cursor, led->list[led->list_head].repeats);
 
+  //endless periodic pattern can be left to hardware, we do not need to wake up for it
+  if(led->running.pattern && led->list[led->list_head].repeats<0 &&
+    !led_pattern_is_static(led->running.pattern) && led_backend->play &&
+    led_backend->play(&led->out, led->running.pattern) == 0)
+  {
+    led->running.offloaded=1;
+    led->running.next_change=LED_NEVER;
+    return;
+  }
+
+  led_update_action(led,t);
 }
 
-//helper, inits action starting at led->list_head
-//always called form critical section protected code
+//helper, performs next step of running action
+//called from led task only
 static void led_update_action(t_led_state *led, uint64_t t)
 {
-  uint64_t next_change;
-  int led_on,list_changed, manage_repeats;
-  int phase;
-  int update_led=0, led_state;
+  const t_led_segment *segment=NULL;
 
   if(led == NULL || led->running.idx<0) return; //nothing to do
-  
-  next_change=(uint64_t)-1;
-  led_on=0;
-  manage_repeats=0;
-  list_changed=0;
-  phase=0;
-
-  switch (led->list[led->running.idx].action)
+
+  if(led->running.pattern)
   {
-  case LED_OFF:
-    break;
-  case LED_ON:
-    led_on=1;
-    break;
-  case LED_BLINKING_SLOWLY:
-    if(led->running.phase)
-    {
-      next_change=t+LED_OFF_TIME_SLOW;
-      manage_repeats=1;
-    }else
-    {
-      led_on=1;
-      next_change=t+LED_ON_TIME;
-      phase=1;  
-    }
-    break;
-  case LED_BLINKING_ANGRY:
-    if(led->running.phase)
-    {
-      next_change=t+LED_OFF_TIME_ANGRY;
-      manage_repeats=1;
-    }else
-    {
-      led_on=1;
-      next_change=t+LED_ON_TIME;
-      phase=1;  
-    }
-    break;
-  case LED_BLINK_ONCE:
-    if(led->running.phase)
-    {
-      next_change=t+LED_OFF_TIME_ONCE;
-      manage_repeats=1;
-    }else
-    {
-      led_on=1;
-      next_change=t+LED_ON_TIME;
-      phase=1;  
-    }
-    break;
+    segment=led_pattern_next(led->running.pattern, &led->running.cursor);
+  }
 
-  default:
-    //seems we have an unsupported action in the list, just skip it and let next action to process on next run
-    if(led->list_len>0)
+  if(segment == NULL)
+  {
+    //action has finished or it is unsupported, drop it and let next action to process on next run
+    led_drop_action(led);
+    led->list_changed=1;
+    if(led->list_len == 0)
     {
-      list_changed=1;
-      INC_LED_LIST_IDX(led->list_head);
-      led->list_len-=1;
+      led_backend->set(&led->out, 0);
     }
-    break;
+    return;
   }
 
-  if(manage_repeats)
+  led->running.next_change=segment->duration ? t+segment->duration : LED_NEVER;
+  led_backend->set(&led->out, segment->on);
+}
+
+//converts time remaining to deadline into ticks to wait, never returns less than remaining time
+static TickType_t led_ticks_to(uint64_t deadline, uint64_t t)
+{
+  uint64_t ms;
+
+  if(deadline == LED_NEVER) return portMAX_DELAY;
+  if(deadline <= t) return 0;
+
+  ms=deadline-t;
+  if(ms >= (uint64_t)(portMAX_DELAY-1)*portTICK_PERIOD_MS) return portMAX_DELAY-1;
+  return (TickType_t)((ms+portTICK_PERIOD_MS-1)/portTICK_PERIOD_MS);
+}
+
+//heap key, time when led needs service
+static inline uint64_t led_deadline(const t_led_state *led)
+{
+  if(led->list_changed) return 0; //as soon as possible
+  if(led->running.idx<0) return LED_NEVER;
+  return led->running.next_change;
+}
+
+//helper, swaps two heap items
+static inline void led_heap_swap(int a, int b)
+{
+  t_led_state *tmp=led_heap[a];
+
+  led_heap[a]=led_heap[b];
+  led_heap[b]=tmp;
+  led_heap[a]->heap_pos=a;
+  led_heap[b]->heap_pos=b;
+}
+
+//restores heap order after key of item at pos has changed
+static void led_heap_fix(int pos)
+{
+  int child;
+
+  //move up
+  while(pos>0 && led_deadline(led_heap[pos])<led_deadline(led_heap[(pos-1)/2]))
   {
-    if(led->list[led->running.idx].repeats>=0 && (--led->list[led->running.idx].repeats)<0)
-    {
-      list_changed=1;
-    }
+    led_heap_swap(pos,(pos-1)/2);
+    pos=(pos-1)/2;
   }
 
-  led->list_changed=list_changed;
-  if(list_changed)
+  //move down
+  while((child=2*pos+1)<led_heap_len)
   {
-    led->running.idx=-1;
+    if(child+1<led_heap_len && led_deadline(led_heap[child+1])<led_deadline(led_heap[child])) child++;
+    if(led_deadline(led_heap[pos])<=led_deadline(led_heap[child])) break;
+    led_heap_swap(pos,child);
+    pos=child;
   }
-  else
+}
+
+static void led_heap_insert(t_led_state *led)
+{
+  led->heap_pos=led_heap_len;
+  led_heap[led_heap_len++]=led;
+  led_heap_fix(led->heap_pos);
+}
+
+static void led_heap_remove(t_led_state *led)
+{
+  int pos=led->heap_pos;
+
+  led->heap_pos=-1;
+  if(--led_heap_len==pos) return; //it was the last one
+
+  led_heap[pos]=led_heap[led_heap_len];
+  led_heap[pos]->heap_pos=pos;
+  led_heap_fix(pos);
+}
+
+//helper, takes over pushed actions, registers new outputs and releases deinitialized ones
+//called from led task only
+static void led_take_pushed(t_led_state *led)
+{
+  t_led_action_cell pushed;
+  unsigned int dropped;
+
+  if(IS_LED_INVALID(led))
   {
-    led->running.next_change=next_change;
-    led->running.phase=phase;
-    update_led=1;
-    led_state=!led->on_state ^ led_on;
+    //led_deinit has only invalidated the state, output is released now, memory once producers leave
+    if(led->zombie) return;
+    if(led->heap_pos>=0) led_heap_remove(led);
+    if(led->running.offloaded) led_backend->stop(&led->out);
+    led_backend->deinit(&led->out);
+    led->zombie=1;
+    led->zombie_next=led_zombies;
+    led_zombies=led;
+    return;
   }
 
-  if(update_led)
+  if(led->heap_pos<0) led_heap_insert(led);
+
+  //move pushed actions to list
+  while(led_ring_pop(led, &pushed))
+  {
+    led_list_add(led, &pushed);
+  }
+  dropped=atomic_exchange_explicit(&led->ring_dropped, 0, memory_order_relaxed);
+  if(dropped)
   {
-    gpio_set_level(led->gpio, led_state);
+    ESP_LOGW(TAG, "%u pushed actions dropped on GPIO %u", dropped, led->out.gpio);
   }
+
+  led_heap_fix(led->heap_pos);
 }
 
-//main task, maintains action queue and performs desired actions
-//ends when handle becomes invalid
-static void led_task(void *handle)
+//helper, frees deinitialized outputs no producer uses anymore, returns whether some are left
+//called from led task only
+static int led_free_zombies(void)
 {
-  t_led_state *led=(t_led_state *)handle; //make it easier to write references..
+  t_led_state **link=&led_zombies, *led;
+
+  while((led=*link)!=NULL)
+  {
+    //producer inside led_push_action may still put led on dirty stack, it is taken off in next cycle
+    if(atomic_load(&led->users) == 0 && atomic_load(&led->queued) == 0)
+    {
+      *link=led->zombie_next;
+      free(led);
+      atomic_fetch_sub(&led_outputs, 1);
+    }
+    else
+    {
+      link=&led->zombie_next;
+    }
+  }
+  return led_zombies!=NULL;
+}
 
-  //integrity check
-  int valid=IS_LED_VALID(led);
-   
-  const TickType_t ten_ms = pdMS_TO_TICKS(10);
-  uint64_t t=0;
+//main task, drives all outputs
+//sleeps until nearest planned change or until notified by led_init / led_push_action / led_deinit
+static void led_task(void *arg)
+{
+  t_led_state *led, *dirty;
+  uint64_t t;
+  TickType_t wait;
 
-  ESP_LOGI(TAG, "Ticks to 10ms: 0x%lx",ten_ms);
+  (void)arg;
 
-  while(valid)
+  for(;;)
   {
-    taskENTER_CRITICAL(&spinlock);
+    t=led_now_ms();
 
-    valid=IS_LED_VALID(led);
+    //service outputs with pushed actions
+    dirty=atomic_exchange(&led_dirty, NULL);
+    while(dirty)
+    {
+      led=dirty;
+      dirty=led->dirty_next;
+      //pushes from now on queue the led again
+      atomic_store(&led->queued, 0);
+      led_take_pushed(led);
+    }
 
-    if(valid) {
+    //perform all changes that are due
+    while(led_heap_len>0 && led_deadline(led_heap[0])<=t)
+    {
+      led=led_heap[0];
       if(led->list_changed)
       {
         led_init_action(led,t);
       }
-      else if(led->running.idx<0)
+      else
       {
-        ; //we have nothing to do
-      }
-      else if(led->running.next_change<=t) //is it right time?
-      {
-        led_update_action(led,t);
+        //keep the period stable by counting from the deadline unless we are too late
+        led_update_action(led,
+          (t-led->running.next_change)<LED_LATE_MAX_MS ? led->running.next_change : t);
       }
+      led_heap_fix(0);
     }
-    taskEXIT_CRITICAL(&spinlock);
-    vTaskDelay(ten_ms);
-    t+=10;
+
+    wait=led_heap_len>0 ? led_ticks_to(led_deadline(led_heap[0]),t) : portMAX_DELAY;
+    //producers leave led_push_action within few instructions, look again in next tick
+    if(led_free_zombies() && wait>1) wait=1;
+
+    //sleep until deadline or until any list changes
+    ulTaskNotifyTake(pdTRUE, wait);
   }
-  ESP_LOGE(TAG, "Task deleted!");
-  vTaskDelete(NULL);
 }
 
-//deinitializes LED task thet leads to its termination in next cycle
+//deinitializes LED output, led task releases it in next cycle
 void led_deinit(void *handle)
 {
-  taskENTER_CRITICAL(&spinlock);
-  if(IS_LED_VALID((t_led_state *)handle))
-  {
-    memset(handle, 0, sizeof(t_led_state));
-    free(handle);
-  }
-  taskEXIT_CRITICAL(&spinlock);
+  t_led_state *led=(t_led_state *)handle;
+  size_t size=sizeof(t_led_state);
+
+  //only first caller invalidates handle
+  if(led == NULL || !atomic_compare_exchange_strong(&led->size, &size, 0)) return;
+
+  //let led task see invalid handle and release it
+  led_notify(led);
 }
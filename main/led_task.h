@@ -11,14 +11,18 @@ typedef enum _t_led_action
   LED_BLINKING_SLOWLY,
   LED_BLINKING_ANGRY,
   LED_BLINK_ONCE,
-  LED_ON
+  LED_ON,
+  LED_DOUBLE_BLINK,
+  LED_SOS,
+  LED_ACTION_COUNT //number of actions, not an action
 } t_led_action;
 
-//initialize LED task on gpio with active state on_state 
+//initialize LED output on gpio with active state on_state, all outputs are driven by one shared task
 void* led_init(const unsigned int gpio, const int on_state);
 //push action into LED task and let it repeat repeats times (use -1 for infinitely repeating action)
+//lock-free, can be called from any task or ISR
 void led_push_action(void *handle, t_led_action led_action, int repeats);
-//deinitializes LED task thet leads to its termination in next cycle
+//deinitializes LED output, it is released by LED task in its next cycle
 void led_deinit(void *handle);
 
 #ifdef __cpluscplus
@@ -5,10 +5,14 @@
 #include <esp_event.h>
 #include <nvs_flash.h>
 #include <esp_netif.h>
+#include <esp_timer.h>
 
 #include <driver/gpio.h>
 
 #include "discordbot.h"
+#include "dib_console.h"
+#include "metrics.h"
+#include "dlog.h"
 
 #include "led_task.h"
 
@@ -16,30 +20,89 @@
 
 static const char *TAG = "discord_bot_main";
 
+//LED handle, valid before connection listener is registered
+static void *lh;
+
+//start of current boot phase, us since boot
+static int64_t boot_phase_start;
+
+//logs duration of boot phase that has just finished
+static void boot_phase(const char *name)
+{
+  int64_t now=esp_timer_get_time();
+
+  ESP_LOGI(TAG, "Boot phase %s took %lld ms, %lld ms since boot", name, (now-boot_phase_start)/1000, now/1000);
+  boot_phase_start=now;
+}
+
+//shows Wi-Fi connection state on LED and tells bot whether link is up
+static void wifi_state_changed(t_wifi_conn_state state, void *arg)
+{
+  switch(state)
+  {
+  case WIFI_CONN_CONNECTED:
+    led_push_action(lh,LED_BLINKING_SLOWLY,-1);
+    break;
+  case WIFI_CONN_REPROVISION:
+    led_push_action(lh,LED_SOS,-1);
+    break;
+  default:
+    led_push_action(lh,LED_BLINKING_ANGRY,-1);
+    break;
+  }
+  dib_network(state == WIFI_CONN_CONNECTED);
+}
+
 /***************************************************** */
 /** MAIN */
+//steps that do not need network run while Wi-Fi associates
 void app_main(void)
 {
   esp_err_t ret;
-  void *lh;
 
   ESP_LOGI(TAG, "App main initializing..");
+  //hot paths log through ring from now on
+  dlog_start();
+
+  ret=nvs_flash_init();
+  if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+  {
+    //NVS partition was truncated and needs to be erased
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ret=nvs_flash_init();
+  }
+  ESP_ERROR_CHECK(ret);
+  boot_phase("nvs");
 
-  ESP_ERROR_CHECK(nvs_flash_init());
   ESP_ERROR_CHECK((esp_netif_init()));
   ESP_ERROR_CHECK(esp_event_loop_create_default());
+  boot_phase("netif");
+
+  //association goes on in background
+  ret=wifi_provision();
+  boot_phase("wifi start");
+
+  //relay edges are captured (and journaled) from now on, REST client is ready
+  dib_init();
+  boot_phase("relay and sender");
 
   lh=led_init(GPIO_NUM_10,0);
   ESP_LOGI(TAG, "led_init returns %p", lh);
-
   led_push_action(lh,LED_BLINKING_ANGRY,-1);
+  if(ret == ESP_OK) wifi_conn_listen(wifi_state_changed, NULL);
 
-  ret=wifi_provision();
+  //diagnostics work even when Wi-Fi does not
+  metrics_start();
+  dib_console_start();
+  boot_phase("led and diagnostics");
+
+  if(ret == ESP_OK) ret=wifi_wait_connected(-1);
 
   if(ret == ESP_OK )
   {
+    boot_phase("wifi connected");
     dib_start();
-    led_push_action(lh,LED_BLINKING_SLOWLY,-1);
+    boot_phase("discord start");
   }
   else{
     led_push_action(lh,LED_BLINKING_ANGRY,-1);
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "dib_clock.h"
+#include "metrics.h"
+
+static const char *TAG = "metrics";
+
+#ifdef CONFIG_METRICS_INTERVAL_S
+#define METRICS_INTERVAL_S CONFIG_METRICS_INTERVAL_S
+#else
+#define METRICS_INTERVAL_S 30
+#endif
+
+//sampling is cheap, but task list walk is not, so it has lowest priority
+#define METRICS_TASK_STACK 3072
+#define METRICS_TASK_PRIO 1
+
+//task sample
+typedef struct _t_metrics_task
+{
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t stack_free; //stack high-water mark, B
+  uint16_t cpu_permille; //CPU use during last interval, -1 when unknown
+} t_metrics_task;
+
+static SemaphoreHandle_t metrics_lock;
+
+//heap samples, ring
+static t_metrics_heap metrics_heap[METRICS_HEAP_SAMPLES];
+static int metrics_heap_next;
+static int metrics_heap_len;
+
+//tasks of latest sample, least stack left first
+static t_metrics_task metrics_tasks[METRICS_TASKS_MAX];
+static int metrics_tasks_len;
+
+//tasks created between counting and sampling
+#define METRICS_TASKS_SLACK 4
+
+#if defined(CONFIG_FREERTOS_USE_TRACE_FACILITY) && defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+//previous sample of all tasks, its run time counters give CPU use, used by metrics task only
+static TaskStatus_t *metrics_prev;
+static int metrics_prev_len;
+static configRUN_TIME_COUNTER_TYPE metrics_prev_total;
+#endif
+
+//helper, samples heap
+static void metrics_sample_heap(t_metrics_heap *h)
+{
+  h->time=(uint32_t)(dib_clock_us()/1000000);
+  h->free=esp_get_free_heap_size();
+  h->min_free=esp_get_minimum_free_heap_size();
+  h->largest=heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+#ifdef CONFIG_FREERTOS_USE_TRACE_FACILITY
+//helper, samples all tasks, METRICS_TASKS_MAX with least stack left go to tasks, returns their number
+static int metrics_sample_tasks(t_metrics_task *tasks)
+{
+  TaskStatus_t *status;
+  UBaseType_t n, size;
+  int i, j, len=0;
+  t_metrics_task t;
+
+  //buffer follows number of tasks, uxTaskGetSystemState returns nothing when it is too small
+  size=uxTaskGetNumberOfTasks()+METRICS_TASKS_SLACK;
+  status=(TaskStatus_t *)malloc(size*sizeof(TaskStatus_t));
+  if(status == NULL)
+  {
+    ESP_LOGW(TAG, "No memory for %u task states", (unsigned int)size);
+    return 0;
+  }
+
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  configRUN_TIME_COUNTER_TYPE total, runtime, dt;
+  n=uxTaskGetSystemState(status, size, &total);
+  dt=total-metrics_prev_total;
+#else
+  n=uxTaskGetSystemState(status, size, NULL);
+#endif
+
+  if(n == 0) ESP_LOGW(TAG, "More than %u tasks, not sampled", (unsigned int)size);
+
+  for(i=0;i<(int)n;i++)
+  {
+    strncpy(t.name, status[i].pcTaskName, sizeof(t.name)-1);
+    t.name[sizeof(t.name)-1]=0;
+    t.stack_free=status[i].usStackHighWaterMark; //bytes in ESP-IDF
+    t.cpu_permille=(uint16_t)-1;
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    //CPU use since previous sample of the same task
+    for(j=0;j<metrics_prev_len;j++)
+    {
+      if(metrics_prev[j].xTaskNumber!=status[i].xTaskNumber) continue;
+      runtime=status[i].ulRunTimeCounter-metrics_prev[j].ulRunTimeCounter;
+      if(dt>0) t.cpu_permille=(uint16_t)((uint64_t)runtime*1000/dt);
+      break;
+    }
+#endif
+
+    //insert sorted, least stack left first, tasks with most stack left fall off the end
+    if(len == METRICS_TASKS_MAX && tasks[len-1].stack_free<=t.stack_free) continue;
+    if(len<METRICS_TASKS_MAX) len++;
+    for(j=len-1;j>0 && tasks[j-1].stack_free>t.stack_free;j--) tasks[j]=tasks[j-1];
+    tasks[j]=t;
+  }
+
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  //this sample is the previous one next time
+  free(metrics_prev);
+  metrics_prev=status;
+  metrics_prev_len=n;
+  metrics_prev_total=total;
+#else
+  free(status);
+#endif
+  return len;
+}
+#endif
+
+//samples heap and tasks periodically
+static void metrics_task(void *arg)
+{
+  t_metrics_heap heap;
+  static t_metrics_task tasks[METRICS_TASKS_MAX];
+  int tasks_len=0;
+
+  for(;;)
+  {
+    metrics_sample_heap(&heap);
+#ifdef CONFIG_FREERTOS_USE_TRACE_FACILITY
+    tasks_len=metrics_sample_tasks(tasks);
+#endif
+
+    xSemaphoreTake(metrics_lock, portMAX_DELAY);
+    metrics_heap[metrics_heap_next]=heap;
+    metrics_heap_next=(metrics_heap_next+1)%METRICS_HEAP_SAMPLES;
+    if(metrics_heap_len<METRICS_HEAP_SAMPLES) metrics_heap_len++;
+    if(tasks_len)
+    {
+      memcpy(metrics_tasks, tasks, sizeof(tasks[0])*tasks_len);
+      metrics_tasks_len=tasks_len;
+    }
+    xSemaphoreGive(metrics_lock);
+
+    vTaskDelay(pdMS_TO_TICKS(METRICS_INTERVAL_S*1000));
+  }
+}
+
+//starts task that samples heap, stack high-water marks and CPU use of tasks periodically
+esp_err_t metrics_start(void)
+{
+  if(metrics_lock) return ESP_OK;
+
+  metrics_lock=xSemaphoreCreateMutex();
+  if(metrics_lock == NULL) return ESP_ERR_NO_MEM;
+
+  if(xTaskCreate(metrics_task, "metrics_task", METRICS_TASK_STACK, NULL, METRICS_TASK_PRIO, NULL)!=pdPASS)
+  {
+    ESP_LOGE(TAG, "Error creating task");
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+//helper, appends line when it fits whole, returns new length
+static size_t metrics_line(char *buf, size_t size, size_t len, const char *line)
+{
+  size_t l=strlen(line);
+
+  if(len+l+1>=size) return len;
+  if(len) buf[len++]='\n';
+  memcpy(buf+len, line, l+1);
+  return len+l;
+}
+
+//renders latest heap sample and tasks (least stack left first), returns length
+//lines that do not fit are left out
+size_t metrics_render(char *buf, size_t size)
+{
+  char line[80];
+  size_t len=0;
+  const t_metrics_heap *h;
+  const t_metrics_task *t;
+
+  if(size == 0) return 0;
+  buf[0]=0;
+  if(metrics_lock == NULL) return 0;
+
+  xSemaphoreTake(metrics_lock, portMAX_DELAY);
+
+  if(metrics_heap_len)
+  {
+    h=&metrics_heap[(metrics_heap_next+METRICS_HEAP_SAMPLES-1)%METRICS_HEAP_SAMPLES];
+    snprintf(line, sizeof(line), "Heap free %u B, min %u B, largest block %u B",
+      (unsigned int)h->free, (unsigned int)h->min_free, (unsigned int)h->largest);
+    len=metrics_line(buf, size, len, line);
+  }
+
+  for(int i=0;i<metrics_tasks_len;i++)
+  {
+    t=&metrics_tasks[i];
+    if(t->cpu_permille == (uint16_t)-1)
+      snprintf(line, sizeof(line), "%s stack left %u B", t->name, (unsigned int)t->stack_free);
+    else
+      snprintf(line, sizeof(line), "%s stack left %u B, cpu %u.%u%%", t->name, (unsigned int)t->stack_free,
+        t->cpu_permille/10, t->cpu_permille%10);
+    len=metrics_line(buf, size, len, line);
+  }
+
+  xSemaphoreGive(metrics_lock);
+  return len;
+}
+
+//renders kept heap samples, oldest first, returns length
+size_t metrics_render_heap(char *buf, size_t size)
+{
+  char line[80];
+  size_t len=0;
+  const t_metrics_heap *h;
+
+  if(size == 0) return 0;
+  buf[0]=0;
+  if(metrics_lock == NULL) return 0;
+
+  xSemaphoreTake(metrics_lock, portMAX_DELAY);
+  for(int i=0;i<metrics_heap_len;i++)
+  {
+    h=&metrics_heap[(metrics_heap_next+METRICS_HEAP_SAMPLES-metrics_heap_len+i)%METRICS_HEAP_SAMPLES];
+    snprintf(line, sizeof(line), "%6u s free %6u min %6u largest %6u",
+      (unsigned int)h->time, (unsigned int)h->free, (unsigned int)h->min_free, (unsigned int)h->largest);
+    len=metrics_line(buf, size, len, line);
+  }
+  xSemaphoreGive(metrics_lock);
+  return len;
+}
@@ -0,0 +1,41 @@
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//number of heap samples kept
+#define METRICS_HEAP_SAMPLES 16
+//number of tasks shown, all tasks are sampled and the ones with least stack left are kept
+#define METRICS_TASKS_MAX 16
+
+//heap sample
+typedef struct _t_metrics_heap
+{
+  uint32_t time; //uptime, s
+  uint32_t free; //free heap, B
+  uint32_t min_free; //minimum free heap since boot, B
+  uint32_t largest; //largest free block, B (fragmentation when far below free)
+} t_metrics_heap;
+
+//starts task that samples heap, stack high-water marks and CPU use of tasks periodically
+esp_err_t metrics_start(void);
+
+//renders latest heap sample and tasks (least stack left first), returns length
+//lines that do not fit are left out
+size_t metrics_render(char *buf, size_t size);
+
+//renders kept heap samples, oldest first, returns length
+size_t metrics_render_heap(char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
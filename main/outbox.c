@@ -0,0 +1,334 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#include "dib_clock.h"
+#include "outbox.h"
+#include "dlog.h"
+
+static const char *TAG = "outbox";
+
+//max number of text messages waiting
+#ifndef OUTBOX_TEXTS_MAX
+#define OUTBOX_TEXTS_MAX 8
+#endif
+
+static SemaphoreHandle_t outbox_lock;
+static TaskHandle_t outbox_consumer;
+
+//journal summary has been requested
+static int outbox_journal_pending;
+static uint8_t outbox_journal_done; //subscribers that got summary already
+
+//max number of channels waiting for reply to !status at once
+#ifndef OUTBOX_REPLIES_MAX
+#define OUTBOX_REPLIES_MAX 4
+#endif
+
+//door state waiting, newer state replaces older one of the same slot
+//broadcasts (no channel) have slot per sensor and one for OUTBOX_SENSOR_ALL, replies have slot per asking channel
+//broadcast and reply are never merged, so a reply does not steal broadcast from subscribers nor the other way
+#define OUTBOX_DOOR_ALL SENSORS_MAX
+#define OUTBOX_DOOR_REPLY (SENSORS_MAX+1)
+#define OUTBOX_DOORS (OUTBOX_DOOR_REPLY+OUTBOX_REPLIES_MAX)
+static t_outbox_msg outbox_doors[OUTBOX_DOORS];
+static uint8_t outbox_doors_pending[OUTBOX_DOORS];
+
+//text messages, FIFO
+static t_outbox_msg outbox_texts[OUTBOX_TEXTS_MAX];
+static int outbox_texts_head; //first to send
+static int outbox_texts_len;
+
+//helper, copies channel id into message, keeps current one when channel_id is NULL
+static void outbox_set_channel(t_outbox_msg *msg, const char *channel_id)
+{
+  if(channel_id == NULL) return;
+  msg->channel_id[0]=0;
+  strncat(msg->channel_id, channel_id, sizeof(msg->channel_id)-1);
+}
+
+//helper, returns slot of door state of sensor, for channel_id (reply) the one waiting for it or a free one
+//returns -1 when all reply slots are taken by other channels
+//called with lock held
+static int outbox_door_slot(int sensor, const char *channel_id)
+{
+  int slot, free_slot=-1;
+
+  if(channel_id == NULL || channel_id[0] == 0) return (sensor<0 || sensor>=SENSORS_MAX) ? OUTBOX_DOOR_ALL : sensor;
+
+  for(slot=OUTBOX_DOOR_REPLY;slot<OUTBOX_DOORS;slot++)
+  {
+    if(!outbox_doors_pending[slot])
+    {
+      if(free_slot<0) free_slot=slot;
+    }
+    else if(strncmp(outbox_doors[slot].channel_id, channel_id, sizeof(outbox_doors[slot].channel_id)-1) == 0)
+    {
+      return slot;
+    }
+  }
+  return free_slot;
+}
+
+//helper, wakes consumer
+static void outbox_notify(void)
+{
+  if(outbox_consumer) xTaskNotifyGive(outbox_consumer);
+}
+
+//initializes outbox, it wakes consumer task by task notification
+esp_err_t outbox_init(void)
+{
+  if(outbox_lock) return ESP_OK;
+
+  outbox_lock=xSemaphoreCreateMutex();
+  if(outbox_lock == NULL)
+  {
+    ESP_LOGE(TAG, "Error creating mutex");
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+//sets task waiting in outbox_take
+void outbox_set_consumer(TaskHandle_t task)
+{
+  outbox_consumer=task;
+}
+
+//queues door state of sensor, its state still waiting is replaced (channel_id may be NULL)
+//edge_time and decide_time are 0 for state that is not a change
+esp_err_t outbox_post_door(const char *channel_id, int sensor, int level, int64_t edge_time, int64_t decide_time)
+{
+  t_outbox_msg *door;
+  int slot;
+
+  if(outbox_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(outbox_lock, portMAX_DELAY);
+
+  slot=outbox_door_slot(sensor, channel_id);
+  if(slot<0)
+  {
+    xSemaphoreGive(outbox_lock);
+    return ESP_ERR_NO_MEM;
+  }
+  door=&outbox_doors[slot];
+
+  if(!outbox_doors_pending[slot])
+  {
+    memset(door, 0, offsetof(t_outbox_msg, content));
+    door->kind=OUTBOX_DOOR;
+    door->sensor=(sensor<0 || sensor>=SENSORS_MAX) ? OUTBOX_SENSOR_ALL : sensor;
+    outbox_set_channel(door, channel_id);
+  }
+  else
+  {
+    DLOGD(DLOG_OUTBOX, "Door %d state %d replaced by %d", sensor, door->level, level);
+  }
+
+  if(edge_time) door->changes++; //state query has no edge
+  door->level=level;
+  door->edge_time=edge_time;
+  door->decide_time=decide_time;
+  door->enqueue_time=dib_clock_us();
+  door->done=0; //new state goes to everybody
+  outbox_doors_pending[slot]=1;
+
+  xSemaphoreGive(outbox_lock);
+
+  outbox_notify();
+  return ESP_OK;
+}
+
+//asks sender to send summary of offline journal
+esp_err_t outbox_post_journal(void)
+{
+  if(outbox_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(outbox_lock, portMAX_DELAY);
+  outbox_journal_pending=1;
+  outbox_journal_done=0; //summary covers new records, everybody gets it
+  xSemaphoreGive(outbox_lock);
+
+  outbox_notify();
+  return ESP_OK;
+}
+
+//helper, queues text rendered from template, args are consumed
+static esp_err_t outbox_post_textv(const char *channel_id, const char *fmt, va_list args)
+{
+  t_outbox_msg *msg;
+  esp_err_t r=ESP_OK;
+
+  if(outbox_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(outbox_lock, portMAX_DELAY);
+
+  if(outbox_texts_len>=OUTBOX_TEXTS_MAX)
+  {
+    r=ESP_ERR_NO_MEM;
+  }
+  else
+  {
+    msg=&outbox_texts[(outbox_texts_head+outbox_texts_len)%OUTBOX_TEXTS_MAX];
+    memset(msg, 0, offsetof(t_outbox_msg, content));
+    msg->kind=OUTBOX_TEXT;
+    outbox_set_channel(msg, channel_id);
+    vsnprintf(msg->content, sizeof(msg->content), fmt, args);
+    msg->enqueue_time=dib_clock_us();
+    outbox_texts_len++;
+  }
+
+  xSemaphoreGive(outbox_lock);
+
+  if(r==ESP_OK) outbox_notify();
+  return r;
+}
+
+//queues copy of text message
+//returns ESP_ERR_NO_MEM when outbox is full
+esp_err_t outbox_post_text(const char *channel_id, const char *content)
+{
+  return outbox_post_textf(channel_id, "%s", content);
+}
+
+//queues text message rendered from printf-like template straight into outbox slot
+//returns ESP_ERR_NO_MEM when outbox is full
+esp_err_t outbox_post_textf(const char *channel_id, const char *fmt, ...)
+{
+  va_list args;
+  esp_err_t r;
+
+  va_start(args, fmt);
+  r=outbox_post_textv(channel_id, fmt, args);
+  va_end(args);
+  return r;
+}
+
+//helper, returns first slot with door state waiting, -1 when there is none
+//called with lock held
+static int outbox_door_pending(void)
+{
+  for(int i=0;i<OUTBOX_DOORS;i++)
+  {
+    if(outbox_doors_pending[i]) return i;
+  }
+  return -1;
+}
+
+//takes most important waiting message, returns 0 when there is none
+//changes go in order of sensors, state of all sensors after them and replies last
+int outbox_take(t_outbox_msg *msg)
+{
+  int r=1, slot;
+
+  if(outbox_lock == NULL) return 0;
+
+  xSemaphoreTake(outbox_lock, portMAX_DELAY);
+
+  if(outbox_journal_pending)
+  {
+    //history goes before current state
+    memset(msg, 0, sizeof(*msg));
+    msg->kind=OUTBOX_JOURNAL;
+    msg->enqueue_time=dib_clock_us();
+    msg->done=outbox_journal_done;
+    outbox_journal_pending=0;
+    outbox_journal_done=0;
+  }
+  else if((slot=outbox_door_pending())>=0)
+  {
+    *msg=outbox_doors[slot];
+    outbox_doors_pending[slot]=0;
+  }
+  else if(outbox_texts_len>0)
+  {
+    *msg=outbox_texts[outbox_texts_head];
+    outbox_texts_head=(outbox_texts_head+1)%OUTBOX_TEXTS_MAX;
+    outbox_texts_len--;
+  }
+  else
+  {
+    r=0;
+  }
+
+  xSemaphoreGive(outbox_lock);
+  return r;
+}
+
+//takes waiting text message for channel_id, returns 0 when next text goes elsewhere or there is none
+int outbox_take_text(const char *channel_id, t_outbox_msg *msg)
+{
+  int r=0;
+
+  if(outbox_lock == NULL) return 0;
+
+  xSemaphoreTake(outbox_lock, portMAX_DELAY);
+
+  if(outbox_texts_len>0 && strcmp(outbox_texts[outbox_texts_head].channel_id, channel_id) == 0)
+  {
+    *msg=outbox_texts[outbox_texts_head];
+    outbox_texts_head=(outbox_texts_head+1)%OUTBOX_TEXTS_MAX;
+    outbox_texts_len--;
+    r=1;
+  }
+
+  xSemaphoreGive(outbox_lock);
+  return r;
+}
+
+//returns taken message back to outbox (it could not be sent yet)
+//door state is dropped when newer one is waiting, text is dropped when outbox is full
+void outbox_requeue(t_outbox_msg *msg)
+{
+  int slot;
+
+  if(outbox_lock == NULL) return;
+
+  xSemaphoreTake(outbox_lock, portMAX_DELAY);
+
+  if(msg->kind == OUTBOX_JOURNAL)
+  {
+    outbox_journal_pending=1;
+    outbox_journal_done=msg->done;
+  }
+  else if(msg->kind == OUTBOX_DOOR)
+  {
+    //slot of the same target, broadcast goes back to broadcast slot and reply to its channel
+    slot=outbox_door_slot(msg->sensor, msg->channel_id);
+    if(slot<0)
+    {
+      DLOGW(DLOG_OUTBOX, "Outbox full, reply dropped");
+    }
+    else if(outbox_doors_pending[slot])
+    {
+      //newer state wins, it just covers more changes
+      outbox_doors[slot].changes+=msg->changes;
+    }
+    else
+    {
+      outbox_doors[slot]=*msg;
+      outbox_doors_pending[slot]=1;
+    }
+  }
+  else if(outbox_texts_len<OUTBOX_TEXTS_MAX)
+  {
+    //it was first, so it goes back to head
+    outbox_texts_head=(outbox_texts_head+OUTBOX_TEXTS_MAX-1)%OUTBOX_TEXTS_MAX;
+    outbox_texts[outbox_texts_head]=*msg;
+    outbox_texts_len++;
+  }
+  else
+  {
+    DLOGW(DLOG_OUTBOX, "Outbox full, message dropped");
+  }
+
+  xSemaphoreGive(outbox_lock);
+}
@@ -0,0 +1,94 @@
+#ifndef __OUTBOX_H
+#define __OUTBOX_H
+
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "sensor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//max length of discord snowflake id incl. terminating zero
+#define OUTBOX_ID_MAX 24
+
+//max length of queued text incl. terminating zero, longer text is truncated
+#ifndef OUTBOX_TEXT_MAX
+#define OUTBOX_TEXT_MAX 320
+#endif
+
+//door message about state of all sensors (not a change)
+#define OUTBOX_SENSOR_ALL -1
+
+//kinds of queued messages, lower value is sent first
+typedef enum _t_outbox_kind
+{
+  OUTBOX_JOURNAL = 0, //summary of door changes journaled while offline, no data
+  OUTBOX_DOOR, //door state, only the latest one of every sensor is kept
+  OUTBOX_TEXT, //command reply or alarm, sent once in order of posting
+  OUTBOX_KIND_COUNT
+} t_outbox_kind;
+
+//message waiting for sender
+typedef struct _t_outbox_msg
+{
+  t_outbox_kind kind;
+  char channel_id[OUTBOX_ID_MAX]; //target channel, empty for default one
+  int64_t enqueue_time; //dib_clock time of (last) enqueue, us
+
+  //OUTBOX_DOOR
+  int sensor; //index of sensor, OUTBOX_SENSOR_ALL for state of all of them
+  int level; //door level (1 open)
+  int64_t edge_time; //time of relay edge, 0 when not known
+  int64_t decide_time; //time debounce confirmed the change, 0 when not known
+  int changes; //number of door state changes merged into this message
+
+  //OUTBOX_DOOR and OUTBOX_JOURNAL
+  uint8_t done; //mask of subscriber slots message has been delivered to
+
+  //OUTBOX_TEXT
+  char content[OUTBOX_TEXT_MAX]; //text rendered in place, nothing is allocated
+} t_outbox_msg;
+
+//initializes outbox, it wakes consumer task by task notification
+esp_err_t outbox_init(void);
+
+//sets task waiting in outbox_take
+void outbox_set_consumer(TaskHandle_t task);
+
+//queues door state of sensor, its state still waiting for the same target is replaced
+//channel_id NULL broadcasts to subscribers, otherwise it is reply to that channel only
+//edge_time and decide_time are 0 for state that is not a change
+//returns ESP_ERR_NO_MEM when too many channels wait for reply
+esp_err_t outbox_post_door(const char *channel_id, int sensor, int level, int64_t edge_time, int64_t decide_time);
+
+//asks sender to send summary of offline journal
+esp_err_t outbox_post_journal(void);
+
+//queues copy of text message
+//returns ESP_ERR_NO_MEM when outbox is full
+esp_err_t outbox_post_text(const char *channel_id, const char *content);
+
+//queues text message rendered from printf-like template straight into outbox slot
+//returns ESP_ERR_NO_MEM when outbox is full
+esp_err_t outbox_post_textf(const char *channel_id, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+//takes most important waiting message, returns 0 when there is none
+int outbox_take(t_outbox_msg *msg);
+
+//takes waiting text message for channel_id, returns 0 when next text goes elsewhere or there is none
+int outbox_take_text(const char *channel_id, t_outbox_msg *msg);
+
+//returns taken message back to outbox (it could not be sent yet)
+//door state is dropped when newer one of the same sensor and target is waiting, text is dropped when outbox is full
+void outbox_requeue(t_outbox_msg *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
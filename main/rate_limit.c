@@ -0,0 +1,95 @@
+#include <string.h>
+
+#include "rate_limit.h"
+
+//Discord allows 5 messages per 5 s in a channel, it is used until server tells its numbers
+#define RATE_LIMIT_DEFAULT_LIMIT 5
+#define RATE_LIMIT_DEFAULT_WINDOW 5000000LL
+
+static t_rate_limit rate_limit_routes[RATE_LIMIT_ROUTES_MAX];
+
+//helper, refills bucket when its window has passed
+static void rate_limit_refill(t_rate_limit *rl, int64_t now)
+{
+  if(rl->reset_at && now>=rl->reset_at)
+  {
+    rl->remaining=rl->limit;
+    rl->reset_at=0;
+  }
+}
+
+//initializes bucket with limit requests per window
+void rate_limit_init(t_rate_limit *rl, int limit, int64_t window)
+{
+  rl->limit=limit;
+  rl->remaining=limit;
+  rl->window=window;
+  rl->reset_at=0;
+  rl->blocked_until=0;
+  rl->last_used=0;
+}
+
+//returns 0 when request may be sent at time now, otherwise how long to wait
+int64_t rate_limit_wait(t_rate_limit *rl, int64_t now)
+{
+  rate_limit_refill(rl, now);
+
+  if(now<rl->blocked_until) return rl->blocked_until-now;
+  if(rl->remaining>0) return 0;
+  return rl->reset_at>now ? rl->reset_at-now : 0;
+}
+
+//returns whether bucket is almost empty, so pending requests should be merged
+int rate_limit_low(const t_rate_limit *rl, int64_t now)
+{
+  if(rl->reset_at && now>=rl->reset_at) return 0; //it is full again
+  return rl->remaining<=1;
+}
+
+//takes one token for request sent at time now
+void rate_limit_consume(t_rate_limit *rl, int64_t now)
+{
+  rate_limit_refill(rl, now);
+
+  if(rl->remaining>0) rl->remaining--;
+  //window starts with first request
+  if(rl->reset_at == 0) rl->reset_at=now+rl->window;
+  rl->last_used=now;
+}
+
+//updates bucket from response headers (X-RateLimit-Limit / Remaining / Reset-After), negative values are unknown
+void rate_limit_update(t_rate_limit *rl, int64_t now, int limit, int remaining, int64_t reset_after)
+{
+  if(limit>0) rl->limit=limit;
+  if(remaining>=0) rl->remaining=remaining;
+  if(reset_after>=0) rl->reset_at=now+reset_after;
+}
+
+//blocks bucket for retry_after (429 Retry-After or back-off after error)
+void rate_limit_block(t_rate_limit *rl, int64_t now, int64_t retry_after)
+{
+  if(now+retry_after>rl->blocked_until) rl->blocked_until=now+retry_after;
+}
+
+//returns bucket of route, least recently used bucket is reused for unknown route
+t_rate_limit *rate_limit_route(const char *route, int64_t now)
+{
+  t_rate_limit *rl, *lru=&rate_limit_routes[0];
+
+  for(int i=0;i<RATE_LIMIT_ROUTES_MAX;i++)
+  {
+    rl=&rate_limit_routes[i];
+    if(rl->route[0] && strncmp(rl->route, route, sizeof(rl->route)) == 0)
+    {
+      rl->last_used=now;
+      return rl;
+    }
+    if(rl->last_used<lru->last_used) lru=rl; //unused bucket has 0
+  }
+
+  rate_limit_init(lru, RATE_LIMIT_DEFAULT_LIMIT, RATE_LIMIT_DEFAULT_WINDOW);
+  lru->route[0]=0;
+  strncat(lru->route, route, sizeof(lru->route)-1);
+  lru->last_used=now;
+  return lru;
+}
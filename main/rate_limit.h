@@ -0,0 +1,56 @@
+#ifndef __RATE_LIMIT_H
+#define __RATE_LIMIT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//max length of route key incl. terminating zero
+#define RATE_LIMIT_ROUTE_MAX 24
+
+//number of routes tracked at once, evicted bucket forgets what server told about it
+//fan-out to all subscribers, default channel (or webhook) and few channels asking commands have to fit
+#ifndef RATE_LIMIT_ROUTES_MAX
+#define RATE_LIMIT_ROUTES_MAX 12
+#endif
+
+//token bucket of one Discord route, all times are in us
+typedef struct _t_rate_limit
+{
+  char route[RATE_LIMIT_ROUTE_MAX]; //route key (channel id), empty when bucket is unused
+  int limit; //bucket size
+  int remaining; //requests left until reset
+  int64_t window; //time to refill bucket when server tells nothing
+  int64_t reset_at; //time when bucket is full again
+  int64_t blocked_until; //no request before this time (429, errors)
+  int64_t last_used; //for replacing least recently used bucket
+} t_rate_limit;
+
+//initializes bucket with limit requests per window
+void rate_limit_init(t_rate_limit *rl, int limit, int64_t window);
+
+//returns 0 when request may be sent at time now, otherwise how long to wait
+int64_t rate_limit_wait(t_rate_limit *rl, int64_t now);
+
+//returns whether bucket is almost empty, so pending requests should be merged
+int rate_limit_low(const t_rate_limit *rl, int64_t now);
+
+//takes one token for request sent at time now
+void rate_limit_consume(t_rate_limit *rl, int64_t now);
+
+//updates bucket from response headers (X-RateLimit-Limit / Remaining / Reset-After), negative values are unknown
+void rate_limit_update(t_rate_limit *rl, int64_t now, int limit, int remaining, int64_t reset_after);
+
+//blocks bucket for retry_after (429 Retry-After or back-off after error)
+void rate_limit_block(t_rate_limit *rl, int64_t now, int64_t retry_after);
+
+//returns bucket of route, least recently used bucket is reused for unknown route
+t_rate_limit *rate_limit_route(const char *route, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
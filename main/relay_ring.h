@@ -0,0 +1,75 @@
+#ifndef __RELAY_RING_H
+#define __RELAY_RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+//relay edges are passed from ISR to relay task through single-producer single-consumer ring
+//edges of all inputs share one ring, GPIO ISR handlers run one after another, so there is still one producer
+//functions are inline, so that push ends up in IRAM together with ISR
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//number of raw edges (of all inputs) buffered between ISR and relay task, must be power of 2
+#define RELAY_EDGES_MAX 64
+#define RELAY_EDGES_MASK (RELAY_EDGES_MAX-1)
+
+//raw relay edge captured by ISR
+typedef struct _t_relay_edge
+{
+  int64_t time; //time of edge, us
+  uint8_t sensor; //index of input
+  uint8_t level; //raw level after edge
+} t_relay_edge;
+
+typedef struct _t_relay_ring
+{
+  t_relay_edge edges[RELAY_EDGES_MAX];
+  atomic_uint head; //next to write, producer only
+  atomic_uint tail; //next to read, consumer only
+  atomic_int overflow; //edge has been lost, consumer has to resynchronize
+} t_relay_ring;
+
+//records edge, returns 0 when ring is full and edge is lost
+static inline int relay_ring_push(t_relay_ring *ring, int sensor, int64_t time, int level)
+{
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+  if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= RELAY_EDGES_MAX)
+  {
+    atomic_store_explicit(&ring->overflow, 1, memory_order_relaxed);
+    return 0;
+  }
+
+  ring->edges[head & RELAY_EDGES_MASK].time = time;
+  ring->edges[head & RELAY_EDGES_MASK].sensor = (uint8_t)sensor;
+  ring->edges[head & RELAY_EDGES_MASK].level = (uint8_t)level;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return 1;
+}
+
+//takes oldest edge, returns 0 when there is none
+static inline int relay_ring_pop(t_relay_ring *ring, t_relay_edge *edge)
+{
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+  if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) return 0;
+
+  *edge = ring->edges[tail & RELAY_EDGES_MASK];
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+  return 1;
+}
+
+//returns whether edges have been lost since last call
+static inline int relay_ring_overflowed(t_relay_ring *ring)
+{
+  return atomic_exchange(&ring->overflow, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensor.h"
+
+//sensor list is parsed once at start, so that relay task works with plain numbers
+
+//helper, parses non-negative number ending at one of ends, returns -1 when there is none
+static long sensor_number(const char **p, const char *ends)
+{
+  char *end;
+  long v;
+
+  if(**p<'0' || **p>'9') return -1;
+  v=strtol(*p, &end, 10);
+  if(*end && strchr(ends, *end) == NULL) return -1;
+  *p=end;
+  return v;
+}
+
+//parses sensor list "name:gpio[:active[:debounce_ms]],..." e.g. "Door:20:1:50,Gate:21:0"
+//active defaults to 1 and debounce to debounce_ms
+//returns number of sensors, -1 when spec is malformed or lists more than max sensors
+int sensor_parse(const char *spec, int debounce_ms, t_sensor_cfg *cfg, int max)
+{
+  const char *p=spec;
+  size_t len;
+  long v;
+  int n=0;
+
+  if(spec == NULL) return -1;
+
+  while(*p)
+  {
+    if(n>=max) return -1;
+
+    len=strcspn(p, ":,");
+    if(len == 0 || len>=SENSOR_NAME_MAX || p[len]!=':') return -1;
+    memcpy(cfg[n].name, p, len);
+    cfg[n].name[len]=0;
+    cfg[n].active=1;
+    cfg[n].debounce_ms=debounce_ms;
+    p+=len+1;
+
+    v=sensor_number(&p, ":,");
+    if(v<0 || v>63) return -1;
+    cfg[n].gpio=(int)v;
+
+    if(*p==':')
+    {
+      p++;
+      v=sensor_number(&p, ":,");
+      if(v<0 || v>1) return -1;
+      cfg[n].active=(int)v;
+    }
+
+    if(*p==':')
+    {
+      p++;
+      v=sensor_number(&p, ",");
+      if(v<1) return -1;
+      cfg[n].debounce_ms=(int)v;
+    }
+
+    //the same pin cannot be monitored twice
+    for(int i=0;i<n;i++)
+    {
+      if(cfg[i].gpio == cfg[n].gpio) return -1;
+    }
+
+    n++;
+    if(*p==',') p++;
+  }
+
+  return n;
+}
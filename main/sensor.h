@@ -0,0 +1,31 @@
+#ifndef __SENSOR_H
+#define __SENSOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//max number of monitored inputs, journal record has 3 bits for sensor index
+#define SENSORS_MAX 8
+//max length of sensor name incl. terminating zero
+#define SENSOR_NAME_MAX 16
+
+//monitored input
+typedef struct _t_sensor_cfg
+{
+  char name[SENSOR_NAME_MAX]; //shown in messages, e.g. Door
+  int gpio; //input pin
+  int active; //raw level that means open
+  int debounce_ms; //level has to stay unchanged this long to be reported
+} t_sensor_cfg;
+
+//parses sensor list "name:gpio[:active[:debounce_ms]],..." e.g. "Door:20:1:50,Gate:21:0"
+//active defaults to 1 and debounce to debounce_ms
+//returns number of sensors, -1 when spec is malformed or lists more than max sensors
+int sensor_parse(const char *spec, int debounce_ms, t_sensor_cfg *cfg, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
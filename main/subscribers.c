@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "outbox.h"
+#include "subscribers.h"
+
+static const char *TAG = "subscribers";
+
+#define SUBSCRIBERS_NAMESPACE "dbot"
+#define SUBSCRIBERS_KEY "subs"
+//single target of REST-only modes, kept apart, so that switching modes does not clobber gateway table
+#define SUBSCRIBERS_SINGLE_KEY "single"
+
+//channel getting changes of some sensors, table is stored to NVS as one blob
+typedef struct _t_subscriber
+{
+  char channel_id[OUTBOX_ID_MAX]; //empty when slot is free
+  uint32_t sensors; //mask of sensor indexes
+  char status_id[OUTBOX_ID_MAX]; //live status message in channel, empty when there is none
+} t_subscriber;
+
+//written by command handler, read by sender task
+static SemaphoreHandle_t subscribers_lock;
+static t_subscriber subscribers[SUBSCRIBERS_MAX];
+static const char *subscribers_key=SUBSCRIBERS_KEY;
+
+//helper, stores table to NVS
+//called with lock held
+static void subscribers_store(void)
+{
+  nvs_handle_t h;
+  esp_err_t r;
+
+  r=nvs_open(SUBSCRIBERS_NAMESPACE, NVS_READWRITE, &h);
+  if(r==ESP_OK)
+  {
+    r=nvs_set_blob(h, subscribers_key, subscribers, sizeof(subscribers));
+    if(r==ESP_OK) r=nvs_commit(h);
+    nvs_close(h);
+  }
+  if(r!=ESP_OK) ESP_LOGE(TAG, "Error 0x%x storing subscribers", r);
+}
+
+//helper, returns slot of channel, -1 when it is not subscribed
+//called with lock held
+static int subscribers_find(const char *channel_id)
+{
+  for(int i=0;i<SUBSCRIBERS_MAX;i++)
+  {
+    if(subscribers[i].channel_id[0] && strcmp(subscribers[i].channel_id, channel_id) == 0) return i;
+  }
+  return -1;
+}
+
+//helper, loads table stored under subscribers_key, returns ESP_OK when it is there
+static esp_err_t subscribers_load(void)
+{
+  nvs_handle_t h;
+  size_t len=sizeof(subscribers);
+  esp_err_t r=ESP_ERR_NVS_NOT_FOUND;
+
+  if(nvs_open(SUBSCRIBERS_NAMESPACE, NVS_READONLY, &h) == ESP_OK)
+  {
+    r=nvs_get_blob(h, subscribers_key, subscribers, &len);
+    nvs_close(h);
+  }
+  if(r == ESP_OK && len!=sizeof(subscribers)) r=ESP_ERR_NVS_INVALID_LENGTH;
+
+  for(int i=0;i<SUBSCRIBERS_MAX;i++)
+  {
+    subscribers[i].channel_id[sizeof(subscribers[i].channel_id)-1]=0;
+    subscribers[i].status_id[sizeof(subscribers[i].status_id)-1]=0;
+  }
+  return r;
+}
+
+//loads subscriber table from NVS, default_channel (may be empty) gets all sensors when table has never been stored
+esp_err_t subscribers_init(const char *default_channel)
+{
+  if(subscribers_lock) return ESP_OK;
+
+  subscribers_lock=xSemaphoreCreateMutex();
+  if(subscribers_lock == NULL) return ESP_ERR_NO_MEM;
+
+  if(subscribers_load()!=ESP_OK)
+  {
+    memset(subscribers, 0, sizeof(subscribers));
+    if(default_channel && default_channel[0])
+    {
+      strncat(subscribers[0].channel_id, default_channel, sizeof(subscribers[0].channel_id)-1);
+      subscribers[0].sensors=SUBSCRIBERS_ALL;
+    }
+  }
+
+  for(int i=0;i<SUBSCRIBERS_MAX;i++)
+  {
+    if(subscribers[i].channel_id[0]) ESP_LOGI(TAG, "Channel %s gets sensors 0x%lx", subscribers[i].channel_id, (unsigned long)subscribers[i].sensors);
+  }
+  return ESP_OK;
+}
+
+//sets up table with channel as the only subscriber of all sensors, for modes without commands
+//stored table of gateway mode is not used, id of live status message of channel survives reboot
+esp_err_t subscribers_init_single(const char *channel)
+{
+  char status_id[OUTBOX_ID_MAX]="";
+
+  if(subscribers_lock) return ESP_OK;
+
+  subscribers_lock=xSemaphoreCreateMutex();
+  if(subscribers_lock == NULL) return ESP_ERR_NO_MEM;
+
+  subscribers_key=SUBSCRIBERS_SINGLE_KEY;
+  //status message belongs to the target it was posted to
+  if(subscribers_load() == ESP_OK && strcmp(subscribers[0].channel_id, channel) == 0)
+  {
+    strncat(status_id, subscribers[0].status_id, sizeof(status_id)-1);
+  }
+
+  memset(subscribers, 0, sizeof(subscribers));
+  if(channel[0] == 0) return ESP_OK; //nothing to send to
+
+  strncat(subscribers[0].channel_id, channel, sizeof(subscribers[0].channel_id)-1);
+  subscribers[0].sensors=SUBSCRIBERS_ALL;
+  strncat(subscribers[0].status_id, status_id, sizeof(subscribers[0].status_id)-1);
+  ESP_LOGI(TAG, "Channel %s gets all sensors", channel);
+  return ESP_OK;
+}
+
+//adds sensors of add mask and removes sensors of remove mask from subscription of channel
+//channel without sensors is removed, mask (may be NULL) receives resulting subscription
+//returns ESP_ERR_NO_MEM when table is full
+esp_err_t subscribers_update(const char *channel_id, uint32_t add, uint32_t remove, uint32_t *mask)
+{
+  esp_err_t r=ESP_OK;
+  uint32_t sensors;
+  int slot;
+
+  if(subscribers_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+
+  slot=subscribers_find(channel_id);
+  sensors=slot<0 ? 0 : subscribers[slot].sensors;
+  sensors=(sensors | add) & ~remove;
+
+  if(slot<0 && sensors)
+  {
+    //take free slot
+    for(slot=0;slot<SUBSCRIBERS_MAX && subscribers[slot].channel_id[0];slot++);
+    if(slot>=SUBSCRIBERS_MAX)
+    {
+      r=ESP_ERR_NO_MEM;
+      sensors=0;
+      goto FNRET;
+    }
+    memset(&subscribers[slot], 0, sizeof(subscribers[slot]));
+    strncat(subscribers[slot].channel_id, channel_id, sizeof(subscribers[slot].channel_id)-1);
+  }
+
+  if(slot>=0 && subscribers[slot].sensors!=sensors)
+  {
+    subscribers[slot].sensors=sensors;
+    if(sensors == 0) memset(&subscribers[slot], 0, sizeof(subscribers[slot]));
+    subscribers_store();
+  }
+
+FNRET:
+  xSemaphoreGive(subscribers_lock);
+  if(mask) *mask=sensors;
+  return r;
+}
+
+//copies channel of slot into channel_id when it is subscribed to sensor (sensor < 0 means any)
+//returns 0 when slot is free or not subscribed
+int subscribers_get(int slot, int sensor, char *channel_id, size_t size)
+{
+  int r=0;
+
+  if(subscribers_lock == NULL || slot<0 || slot>=SUBSCRIBERS_MAX || size == 0) return 0;
+
+  xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+  if(subscribers[slot].channel_id[0] && (sensor<0 ? subscribers[slot].sensors!=0 : (subscribers[slot].sensors>>sensor)&1))
+  {
+    channel_id[0]=0;
+    strncat(channel_id, subscribers[slot].channel_id, size-1);
+    r=1;
+  }
+  xSemaphoreGive(subscribers_lock);
+  return r;
+}
+
+//copies id of live status message of slot into message_id (empty when there is none)
+void subscribers_status_get(int slot, char *message_id, size_t size)
+{
+  if(size == 0) return;
+  message_id[0]=0;
+  if(subscribers_lock == NULL || slot<0 || slot>=SUBSCRIBERS_MAX) return;
+
+  xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+  strncat(message_id, subscribers[slot].status_id, size-1);
+  xSemaphoreGive(subscribers_lock);
+}
+
+//sets id of live status message of slot, it is stored to NVS
+void subscribers_status_set(int slot, const char *message_id)
+{
+  if(subscribers_lock == NULL || slot<0 || slot>=SUBSCRIBERS_MAX) return;
+
+  xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+  if(subscribers[slot].channel_id[0] && strcmp(subscribers[slot].status_id, message_id) != 0)
+  {
+    subscribers[slot].status_id[0]=0;
+    strncat(subscribers[slot].status_id, message_id, sizeof(subscribers[slot].status_id)-1);
+    subscribers_store();
+  }
+  xSemaphoreGive(subscribers_lock);
+}
@@ -0,0 +1,45 @@
+#ifndef __SUBSCRIBERS_H
+#define __SUBSCRIBERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//max number of channels getting sensor changes, delivery to them is tracked in 8-bit mask
+#define SUBSCRIBERS_MAX 8
+
+//sensor mask meaning every sensor
+#define SUBSCRIBERS_ALL 0xFFFFFFFFu
+
+//loads subscriber table from NVS, default_channel (may be empty) gets all sensors when table has never been stored
+esp_err_t subscribers_init(const char *default_channel);
+
+//sets up table with channel as the only subscriber of all sensors, for modes without commands
+//stored table of gateway mode is not used, id of live status message of channel survives reboot
+esp_err_t subscribers_init_single(const char *channel);
+
+//adds sensors of add mask and removes sensors of remove mask from subscription of channel
+//channel without sensors is removed, mask (may be NULL) receives resulting subscription
+//returns ESP_ERR_NO_MEM when table is full
+esp_err_t subscribers_update(const char *channel_id, uint32_t add, uint32_t remove, uint32_t *mask);
+
+//copies channel of slot into channel_id when it is subscribed to sensor (sensor < 0 means any)
+//returns 0 when slot is free or not subscribed
+int subscribers_get(int slot, int sensor, char *channel_id, size_t size);
+
+//copies id of live status message of slot into message_id (empty when there is none)
+void subscribers_status_get(int slot, char *message_id, size_t size);
+
+//sets id of live status message of slot, it is stored to NVS
+void subscribers_status_set(int slot, const char *message_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
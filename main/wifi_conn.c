@@ -0,0 +1,153 @@
+#include <stdio.h>
+
+#include "wifi_conn.h"
+
+//caller serializes calls, time is passed in, so fake driver and clock make it deterministic
+
+static const char *const wifi_conn_names[WIFI_CONN_STATE_COUNT]={
+  [WIFI_CONN_IDLE] = "idle",
+  [WIFI_CONN_CONNECTING] = "connecting",
+  [WIFI_CONN_CONNECTED] = "connected",
+  [WIFI_CONN_BACKOFF] = "backoff",
+  [WIFI_CONN_REPROVISION] = "reprovision",
+};
+
+//helper, xorshift32
+static uint32_t wifi_conn_random(t_wifi_conn *c)
+{
+  uint32_t x=c->rng;
+
+  x^=x<<13;
+  x^=x>>17;
+  x^=x<<5;
+  c->rng=x;
+  return x;
+}
+
+//helper, switches state and tells driver
+static void wifi_conn_set(t_wifi_conn *c, t_wifi_conn_state state)
+{
+  if(c->state == state) return;
+  c->state=state;
+  if(c->driver->changed) c->driver->changed(c->ctx, state);
+}
+
+//helper, starts attempt
+static void wifi_conn_attempt(t_wifi_conn *c)
+{
+  c->attempts++;
+  wifi_conn_set(c, WIFI_CONN_CONNECTING);
+  c->driver->connect(c->ctx);
+}
+
+//helper, attempt failed, waits random time from <backoff/2, backoff) and doubles backoff
+static void wifi_conn_failed(t_wifi_conn *c, int64_t now)
+{
+  int64_t half;
+
+  c->failures++;
+
+  if(c->auth_failures_max && c->auth_failures>=c->auth_failures_max && c->driver->reprovision)
+  {
+    wifi_conn_set(c, WIFI_CONN_REPROVISION);
+    c->driver->reprovision(c->ctx);
+    return;
+  }
+
+  half=c->backoff/2;
+  c->retry_at=now+half+(half>0 ? (int64_t)(wifi_conn_random(c)%(uint64_t)half) : 0);
+  c->backoff*=2;
+  if(c->backoff>c->backoff_max) c->backoff=c->backoff_max;
+  wifi_conn_set(c, WIFI_CONN_BACKOFF);
+}
+
+//initializes manager in IDLE state, seed makes jitter differ between devices
+void wifi_conn_init(t_wifi_conn *c, const t_wifi_conn_driver *driver, void *ctx,
+  int64_t backoff_min, int64_t backoff_max, int auth_failures_max, uint32_t seed)
+{
+  c->state=WIFI_CONN_IDLE;
+  c->driver=driver;
+  c->ctx=ctx;
+  c->backoff_min=backoff_min;
+  c->backoff_max=backoff_max<backoff_min ? backoff_min : backoff_max;
+  c->backoff=backoff_min;
+  c->retry_at=0;
+  c->auth_failures_max=auth_failures_max;
+  c->rng=seed ? seed : 0x9e3779b9u;
+  c->failures=0;
+  c->auth_failures=0;
+  c->attempts=0;
+  c->connects=0;
+  c->drops=0;
+}
+
+//feeds event that happened at time now (us)
+void wifi_conn_event(t_wifi_conn *c, t_wifi_conn_event event, int64_t now)
+{
+  switch(event)
+  {
+  case WIFI_CONN_EV_START:
+    if(c->state == WIFI_CONN_IDLE) wifi_conn_attempt(c);
+    break;
+
+  case WIFI_CONN_EV_GOT_IP:
+    //provisioning may connect on its own as well
+    c->failures=0;
+    c->auth_failures=0;
+    c->backoff=c->backoff_min;
+    c->connects++;
+    wifi_conn_set(c, WIFI_CONN_CONNECTED);
+    break;
+
+  case WIFI_CONN_EV_DISCONNECTED:
+  case WIFI_CONN_EV_AUTH_FAILED:
+    if(event == WIFI_CONN_EV_AUTH_FAILED) c->auth_failures++;
+    else c->auth_failures=0;
+
+    if(c->state == WIFI_CONN_CONNECTED)
+    {
+      //connection has been lost, first attempt goes right away
+      c->drops++;
+      wifi_conn_attempt(c);
+    }
+    else if(c->state == WIFI_CONN_CONNECTING)
+    {
+      wifi_conn_failed(c, now);
+    }
+    //BACKOFF ignores late events of previous attempt, REPROVISION leaves it to provisioning
+    break;
+
+  case WIFI_CONN_EV_TIMER:
+    if(c->state == WIFI_CONN_BACKOFF && now>=c->retry_at) wifi_conn_attempt(c);
+    break;
+
+  default:
+    break;
+  }
+}
+
+//returns time WIFI_CONN_EV_TIMER is due, -1 when none
+int64_t wifi_conn_deadline(const t_wifi_conn *c)
+{
+  return c->state == WIFI_CONN_BACKOFF ? c->retry_at : -1;
+}
+
+//returns name of state
+const char *wifi_conn_state_name(t_wifi_conn_state state)
+{
+  if((unsigned)state>=WIFI_CONN_STATE_COUNT) return "?";
+  return wifi_conn_names[state];
+}
+
+//renders state and counters, returns length
+size_t wifi_conn_render(const t_wifi_conn *c, char *buf, size_t size)
+{
+  int len;
+
+  if(size == 0) return 0;
+  len=snprintf(buf, size, "Wi-Fi %s, attempts %u, connects %u, drops %u, failures in row %d, next backoff %lld ms",
+    wifi_conn_state_name(c->state), (unsigned int)c->attempts, (unsigned int)c->connects, (unsigned int)c->drops,
+    c->failures, (long long)(c->backoff/1000));
+  if(len<0) return 0;
+  return (size_t)len<size ? (size_t)len : size-1;
+}
@@ -0,0 +1,86 @@
+#ifndef __WIFI_CONN_H
+#define __WIFI_CONN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//state of station connection
+typedef enum _t_wifi_conn_state
+{
+  WIFI_CONN_IDLE = 0, //not started
+  WIFI_CONN_CONNECTING, //association and DHCP in progress
+  WIFI_CONN_CONNECTED, //station has IP address
+  WIFI_CONN_BACKOFF, //waiting before next attempt
+  WIFI_CONN_REPROVISION, //credentials are rejected, provisioning service is running
+  WIFI_CONN_STATE_COUNT
+} t_wifi_conn_state;
+
+//what happened to station
+typedef enum _t_wifi_conn_event
+{
+  WIFI_CONN_EV_START = 0, //station has been started
+  WIFI_CONN_EV_GOT_IP, //station got IP address
+  WIFI_CONN_EV_DISCONNECTED, //association failed or has been lost
+  WIFI_CONN_EV_AUTH_FAILED, //AP rejected credentials
+  WIFI_CONN_EV_TIMER, //deadline returned by wifi_conn_deadline has passed
+  WIFI_CONN_EV_COUNT
+} t_wifi_conn_event;
+
+//what state machine does to Wi-Fi, real driver calls esp_wifi, fake one records calls
+typedef struct _t_wifi_conn_driver
+{
+  //starts association attempt
+  void (*connect)(void *ctx);
+  //starts provisioning service, NULL when it is not supported
+  void (*reprovision)(void *ctx);
+  //state has changed
+  void (*changed)(void *ctx, t_wifi_conn_state state);
+} t_wifi_conn_driver;
+
+//connection manager, attempts are spaced by jittered exponential backoff
+typedef struct _t_wifi_conn
+{
+  t_wifi_conn_state state;
+  const t_wifi_conn_driver *driver;
+  void *ctx; //passed to driver
+
+  int64_t backoff_min; //us
+  int64_t backoff_max; //us
+  int64_t backoff; //next backoff before jitter, us
+  int64_t retry_at; //end of BACKOFF state, us
+  int auth_failures_max; //consecutive auth failures leading to REPROVISION, 0 never
+  uint32_t rng; //jitter random state, never 0
+
+  //counters
+  int failures; //consecutive failed attempts
+  int auth_failures; //consecutive rejected attempts
+  uint32_t attempts; //all attempts
+  uint32_t connects; //successful connections
+  uint32_t drops; //lost connections
+} t_wifi_conn;
+
+//initializes manager in IDLE state, seed makes jitter differ between devices
+void wifi_conn_init(t_wifi_conn *c, const t_wifi_conn_driver *driver, void *ctx,
+  int64_t backoff_min, int64_t backoff_max, int auth_failures_max, uint32_t seed);
+
+//feeds event that happened at time now (us)
+void wifi_conn_event(t_wifi_conn *c, t_wifi_conn_event event, int64_t now);
+
+//returns time WIFI_CONN_EV_TIMER is due, -1 when none
+int64_t wifi_conn_deadline(const t_wifi_conn *c);
+
+//returns name of state
+const char *wifi_conn_state_name(t_wifi_conn_state state);
+
+//renders state and counters, returns length
+size_t wifi_conn_render(const t_wifi_conn *c, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -13,11 +13,16 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
+#include <freertos/semphr.h>
 
 #include <esp_log.h>
 #include <esp_wifi.h>
 #include <esp_event.h>
 #include <nvs_flash.h>
+#include <nvs.h>
+#include <esp_timer.h>
+#include <esp_netif.h>
+#include <esp_random.h>
 //#include <esp_http_server.h>
 
 #include <wifi_provisioning/manager.h>
@@ -32,6 +37,143 @@ static const char *TAG = "wifi_provisioning";
 const int WIFI_CONNECTED_EVENT = BIT0;
 static EventGroupHandle_t wifi_event_group;
 
+/* NVS namespace of last good AP, it is tried first after boot */
+#define WIFI_FAST_NAMESPACE "wifi_fast"
+
+/* Last good AP */
+typedef struct _t_wifi_fast
+{
+  uint8_t channel;
+  uint8_t bssid[6];
+} t_wifi_fast;
+
+static t_wifi_fast wifi_fast_cached;
+/* connection to cached AP is being tried, full scan follows when it fails */
+static int wifi_fast_attempt;
+static esp_netif_t *wifi_sta_netif;
+
+#ifdef CONFIG_WIFI_BACKOFF_MIN_MS
+#define WIFI_BACKOFF_MIN_MS CONFIG_WIFI_BACKOFF_MIN_MS
+#define WIFI_BACKOFF_MAX_MS CONFIG_WIFI_BACKOFF_MAX_MS
+#define WIFI_REPROVISION_AFTER CONFIG_WIFI_REPROVISION_AFTER
+#else
+#define WIFI_BACKOFF_MIN_MS 1000
+#define WIFI_BACKOFF_MAX_MS 60000
+#define WIFI_REPROVISION_AFTER 10
+#endif
+
+/* Connection manager, reconnects are spaced by jittered exponential backoff */
+#define WIFI_CONN_LISTENERS_MAX 4
+typedef struct _t_wifi_conn_listener
+{
+  void (*cb)(t_wifi_conn_state state, void *arg);
+  void *arg;
+} t_wifi_conn_listener;
+
+static t_wifi_conn wifi_conn;
+static SemaphoreHandle_t wifi_conn_lock;
+static esp_timer_handle_t wifi_conn_timer;
+static t_wifi_conn_listener wifi_conn_listeners[WIFI_CONN_LISTENERS_MAX];
+static int wifi_conn_listeners_len;
+
+static void wifi_conn_feed(t_wifi_conn_event event);
+
+/* Tells whether disconnect reason means that AP rejected our credentials */
+static int wifi_reason_is_auth(uint8_t reason)
+{
+  return reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT ||
+         reason == WIFI_REASON_HANDSHAKE_TIMEOUT;
+}
+
+/* Loads last good AP from NVS, returns 0 when there is none */
+static int wifi_fast_load(t_wifi_fast *fast)
+{
+  nvs_handle_t h;
+  size_t len = sizeof(fast->bssid);
+  int r = 0;
+
+  if (nvs_open(WIFI_FAST_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return 0;
+  if (nvs_get_u8(h, "ch", &fast->channel) == ESP_OK &&
+      nvs_get_blob(h, "bssid", fast->bssid, &len) == ESP_OK && len == sizeof(fast->bssid) && fast->channel)
+  {
+    r = 1;
+  }
+  nvs_close(h);
+  return r;
+}
+
+/* Stores AP we are connected to, NVS is written only when it has changed */
+static void wifi_fast_store(void)
+{
+  wifi_ap_record_t ap;
+  nvs_handle_t h;
+
+  if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) return;
+  if (ap.primary == wifi_fast_cached.channel && memcmp(ap.bssid, wifi_fast_cached.bssid, sizeof(ap.bssid)) == 0) return;
+
+  if (nvs_open(WIFI_FAST_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return;
+  nvs_set_u8(h, "ch", ap.primary);
+  nvs_set_blob(h, "bssid", ap.bssid, sizeof(ap.bssid));
+  nvs_commit(h);
+  nvs_close(h);
+
+  wifi_fast_cached.channel = ap.primary;
+  memcpy(wifi_fast_cached.bssid, ap.bssid, sizeof(ap.bssid));
+  ESP_LOGI(TAG, "AP " MACSTR " on channel %d cached", MAC2STR(ap.bssid), ap.primary);
+}
+
+/* Points station config to cached AP (fast == 1) or lets it scan all channels (fast == 0)
+ * Pinned config lives in RAM only, flash keeps plain credentials, so a boot or roam never depends on one BSSID */
+static void wifi_fast_apply(int fast)
+{
+  wifi_config_t wcfg;
+
+  if (esp_wifi_get_config(WIFI_IF_STA, &wcfg) != ESP_OK) return;
+
+  if (fast)
+  {
+    wcfg.sta.channel = wifi_fast_cached.channel;
+    wcfg.sta.bssid_set = true;
+    memcpy(wcfg.sta.bssid, wifi_fast_cached.bssid, sizeof(wcfg.sta.bssid));
+    wcfg.sta.scan_method = WIFI_FAST_SCAN;
+  }
+  else
+  {
+    wcfg.sta.channel = 0;
+    wcfg.sta.bssid_set = false;
+    wcfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+  }
+  esp_wifi_set_storage(WIFI_STORAGE_RAM);
+  esp_wifi_set_config(WIFI_IF_STA, &wcfg);
+  esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+  wifi_fast_attempt = fast;
+}
+
+#ifdef CONFIG_WIFI_STATIC_IP
+/* Sets static address, so that DHCP is skipped, called once station is associated */
+static void wifi_static_ip(esp_netif_t *netif)
+{
+  esp_netif_ip_info_t ip = {0};
+  esp_netif_dns_info_t dns = {0};
+
+  ip.ip.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_ADDR);
+  ip.gw.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_GW);
+  ip.netmask.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_NETMASK);
+
+  esp_netif_dhcpc_stop(netif);
+  if (esp_netif_set_ip_info(netif, &ip) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Static IP cannot be set, using DHCP");
+    esp_netif_dhcpc_start(netif);
+    return;
+  }
+
+  dns.ip.u_addr.ip4.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_DNS);
+  dns.ip.type = ESP_IPADDR_TYPE_V4;
+  esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+}
+#endif
+
 /* Event handler for catching system events */
 static void event_handler(void *arg, esp_event_base_t event_base,
                           int32_t event_id, void *event_data)
@@ -85,12 +227,27 @@ static void event_handler(void *arg, esp_event_base_t event_base,
     switch (event_id)
     {
     case WIFI_EVENT_STA_START:
-      esp_wifi_connect();
+      wifi_conn_feed(WIFI_CONN_EV_START);
+      break;
+#ifdef CONFIG_WIFI_STATIC_IP
+    case WIFI_EVENT_STA_CONNECTED:
+      wifi_static_ip(wifi_sta_netif);
       break;
+#endif
     case WIFI_EVENT_STA_DISCONNECTED:
-      ESP_LOGI(TAG, "Disconnected. Connecting to the AP again...");
-      esp_wifi_connect();
+    {
+      wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
+      if (wifi_fast_attempt)
+      {
+        /* cached AP is gone or moved, look for any AP of the network (any disconnect while pinned) */
+        ESP_LOGW(TAG, "Cached AP failed, scanning all channels");
+        wifi_fast_apply(0);
+      }
+      ESP_LOGI(TAG, "Disconnected, reason %d", event->reason);
+      /* connection manager decides when to try again */
+      wifi_conn_feed(wifi_reason_is_auth(event->reason) ? WIFI_CONN_EV_AUTH_FAILED : WIFI_CONN_EV_DISCONNECTED);
       break;
+    }
     case WIFI_EVENT_AP_STACONNECTED:
       ESP_LOGI(TAG, "SoftAP transport: Connected!");
       break;
@@ -104,7 +261,12 @@ static void event_handler(void *arg, esp_event_base_t event_base,
   else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
   {
     ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-    ESP_LOGI(TAG, "Connected with IP Address:" IPSTR, IP2STR(&event->ip_info.ip));
+    ESP_LOGI(TAG, "Connected with IP Address:" IPSTR " %lld ms after boot", IP2STR(&event->ip_info.ip),
+             esp_timer_get_time() / 1000);
+    /* cached AP has done its job, later reconnects (roam, AP swap, channel change) scan again */
+    if (wifi_fast_attempt) wifi_fast_apply(0);
+    wifi_fast_store();
+    wifi_conn_feed(WIFI_CONN_EV_GOT_IP);
     /* Signal main application to continue execution */
     xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_EVENT);
   }
@@ -129,8 +291,24 @@ static void event_handler(void *arg, esp_event_base_t event_base,
 
 static void wifi_init_sta(void)
 {
+  wifi_config_t wcfg;
+
   /* Start Wi-Fi in station mode */
   ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+  /* earlier firmware stored pinned config to flash, give flash plain one back once */
+  if (esp_wifi_get_config(WIFI_IF_STA, &wcfg) == ESP_OK && wcfg.sta.bssid_set)
+  {
+    wcfg.sta.channel = 0;
+    wcfg.sta.bssid_set = false;
+    wcfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    esp_wifi_set_config(WIFI_IF_STA, &wcfg);
+  }
+  /* Last good AP is tried first, so that scan is skipped */
+  if (wifi_fast_load(&wifi_fast_cached))
+  {
+    ESP_LOGI(TAG, "Trying cached AP " MACSTR " on channel %d", MAC2STR(wifi_fast_cached.bssid), wifi_fast_cached.channel);
+    wifi_fast_apply(1);
+  }
   ESP_ERROR_CHECK(esp_wifi_start());
 }
 
@@ -143,38 +321,184 @@ static void get_device_service_name(char *service_name, size_t max)
            ssid_prefix, eth_mac[3], eth_mac[4], eth_mac[5]);
 }
 
+/* Initializes provisioning manager */
+static esp_err_t wifi_prov_init(void)
+{
+  /* Configuration for the provisioning manager */
+  wifi_prov_mgr_config_t config = {
+#ifdef CONFIG_EXAMPLE_RESET_PROV_MGR_ON_FAILURE
+      .wifi_prov_conn_cfg = {
+          .wifi_conn_attempts = CONFIG_EXAMPLE_PROV_MGR_CONNECTION_CNT,
+      },
+#endif
+      /* What is the Provisioning Scheme that we want ?
+       * wifi_prov_scheme_softap or wifi_prov_scheme_ble -> wifi_prov_scheme_softap*/
+      .scheme = wifi_prov_scheme_softap,
+
+      /* WIFI_PROV_EVENT_HANDLER_NONE when using wifi_prov_scheme_softap*/
+      .scheme_event_handler = WIFI_PROV_EVENT_HANDLER_NONE
+  };
+
+  /* Initialize provisioning manager with the
+   * configuration parameters set above */
+  return wifi_prov_mgr_init(config);
+}
+
+/* Starts provisioning service, provisioning manager must have been initialized */
+static esp_err_t wifi_prov_start(void)
+{
+  ESP_LOGI(TAG, "Starting provisioning");
+
+  /* What is the Device Service Name that we want
+   * This translates to :
+   *     - Wi-Fi SSID when scheme is wifi_prov_scheme_softap
+   *     - device name when scheme is wifi_prov_scheme_ble
+   */
+  char service_name[12];
+  get_device_service_name(service_name, sizeof(service_name));
+
+  /* What is the security level that we want (0, 1, 2):
+   *      - WIFI_PROV_SECURITY_0 is simply plain text communication.
+   */
+  wifi_prov_security_t security = WIFI_PROV_SECURITY_0;
+
+  /* What is the service key (could be NULL)
+   * This translates to :
+   *     - Wi-Fi password when scheme is wifi_prov_scheme_softap
+   *          (Minimum expected length: 8, maximum 64 for WPA2-PSK)
+   */
+  const char *service_key = "password";
+
+  /* Start provisioning service */
+  ESP_LOGI(TAG, "starting provisioning...");
+  return wifi_prov_mgr_start_provisioning(security, NULL, service_name, service_key);
+}
+
+/* Connection manager driver, called with wifi_conn_lock held */
+static void wifi_conn_do_connect(void *ctx)
+{
+  esp_wifi_connect();
+}
+
+static void wifi_conn_do_reprovision(void *ctx)
+{
+  ESP_LOGW(TAG, "Credentials rejected %d times, starting provisioning service", wifi_conn.auth_failures);
+  if (wifi_prov_init() != ESP_OK || wifi_prov_start() != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Provisioning service cannot be started");
+  }
+}
+
+static void wifi_conn_do_changed(void *ctx, t_wifi_conn_state state)
+{
+  ESP_LOGI(TAG, "Connection %s", wifi_conn_state_name(state));
+  for (int i = 0; i < wifi_conn_listeners_len; i++)
+  {
+    wifi_conn_listeners[i].cb(state, wifi_conn_listeners[i].arg);
+  }
+}
+
+static const t_wifi_conn_driver wifi_conn_driver = {
+  .connect = wifi_conn_do_connect,
+  .reprovision = wifi_conn_do_reprovision,
+  .changed = wifi_conn_do_changed,
+};
+
+/* Feeds event to connection manager and plans its timer */
+static void wifi_conn_feed(t_wifi_conn_event event)
+{
+  int64_t deadline, now;
+
+  if (wifi_conn_lock == NULL) return;
+
+  xSemaphoreTake(wifi_conn_lock, portMAX_DELAY);
+  now = esp_timer_get_time();
+  wifi_conn_event(&wifi_conn, event, now);
+  deadline = wifi_conn_deadline(&wifi_conn);
+  esp_timer_stop(wifi_conn_timer);
+  if (deadline >= 0)
+  {
+    ESP_LOGI(TAG, "Next attempt in %lld ms", (deadline - now) / 1000);
+    esp_timer_start_once(wifi_conn_timer, deadline > now ? deadline - now : 0);
+  }
+  xSemaphoreGive(wifi_conn_lock);
+}
+
+/* Backoff has passed */
+static void wifi_conn_timer_cb(void *arg)
+{
+  wifi_conn_feed(WIFI_CONN_EV_TIMER);
+}
+
+/* Creates connection manager */
+static esp_err_t wifi_conn_setup(void)
+{
+  const esp_timer_create_args_t timer_args = {
+    .callback = wifi_conn_timer_cb,
+    .name = "wifi_conn",
+  };
+
+  if (wifi_conn_lock) return ESP_OK;
+
+  if (esp_timer_create(&timer_args, &wifi_conn_timer) != ESP_OK) return ESP_ERR_NO_MEM;
+  wifi_conn_init(&wifi_conn, &wifi_conn_driver, NULL, WIFI_BACKOFF_MIN_MS * 1000LL, WIFI_BACKOFF_MAX_MS * 1000LL,
+                 WIFI_REPROVISION_AFTER, esp_random());
+  wifi_conn_lock = xSemaphoreCreateMutex();
+  return wifi_conn_lock ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/* Registers callback of connection state changes, it is called with current state right away */
+esp_err_t wifi_conn_listen(void (*cb)(t_wifi_conn_state state, void *arg), void *arg)
+{
+  esp_err_t r = ESP_OK;
+
+  if (wifi_conn_setup() != ESP_OK) return ESP_ERR_NO_MEM;
+
+  xSemaphoreTake(wifi_conn_lock, portMAX_DELAY);
+  if (wifi_conn_listeners_len >= WIFI_CONN_LISTENERS_MAX)
+  {
+    r = ESP_ERR_NO_MEM;
+  }
+  else
+  {
+    wifi_conn_listeners[wifi_conn_listeners_len].cb = cb;
+    wifi_conn_listeners[wifi_conn_listeners_len].arg = arg;
+    wifi_conn_listeners_len++;
+    cb(wifi_conn.state, arg);
+  }
+  xSemaphoreGive(wifi_conn_lock);
+  return r;
+}
+
+/* Renders connection state and counters */
+size_t wifi_conn_status(char *buf, size_t size)
+{
+  size_t len;
+
+  if (wifi_conn_lock == NULL || size == 0) return 0;
+
+  xSemaphoreTake(wifi_conn_lock, portMAX_DELAY);
+  len = wifi_conn_render(&wifi_conn, buf, size);
+  xSemaphoreGive(wifi_conn_lock);
+  return len;
+}
+
 /** 
 main wifi provisioning function
-initializes and starts wifi provisioning / connection to wifi
+initializes and starts wifi provisioning / connection to wifi, it does not wait for connection
+NVS, netif and default event loop must have been initialized
 */
 esp_err_t wifi_provision(void)
 {
   const char *step;
-  /* Initialize NVS partition */
-  step="Initialize NVS partition";
-  esp_err_t ret = nvs_flash_init();
-  if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
-  {
-    /* NVS partition was truncated
-     * and needs to be erased */
-    ESP_ERROR_CHECK(nvs_flash_erase());
+  esp_err_t ret;
 
-    /* Retry nvs_flash_init */
-    ESP_ERROR_CHECK(nvs_flash_init());
-  }
+  wifi_event_group = xEventGroupCreate();
 
-  /* Initialize TCP/IP */
-  step="Initialize TCP/IP";
-  ret=esp_netif_init();
+  step="Create connection manager";
+  ret=wifi_conn_setup();
   if (ret != ESP_OK) goto FNRET;
 
-  /* Initialize the event loop */
-  step="Initialize the event loop";
-  ret=esp_event_loop_create_default();
-  if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) goto FNRET;
-
-  wifi_event_group = xEventGroupCreate();
-
   /* Register our event handler for Wi-Fi, IP and Provisioning events */
   step="Register WIFI_PROV_EVENT handler";
   ret=esp_event_handler_register(WIFI_PROV_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL);
@@ -189,7 +513,7 @@ esp_err_t wifi_provision(void)
   if (ret != ESP_OK) goto FNRET;
 
   /* Initialize Wi-Fi including netif with default config */
-  esp_netif_create_default_wifi_sta();
+  wifi_sta_netif = esp_netif_create_default_wifi_sta();
   esp_netif_create_default_wifi_ap();
 
   step="esp_wifi_init";
@@ -197,25 +521,8 @@ esp_err_t wifi_provision(void)
   ret=esp_wifi_init(&cfg);
   if (ret != ESP_OK) goto FNRET;
 
-  /* Configuration for the provisioning manager */
-  wifi_prov_mgr_config_t config = {
-#ifdef CONFIG_EXAMPLE_RESET_PROV_MGR_ON_FAILURE
-      .wifi_prov_conn_cfg = {
-          .wifi_conn_attempts = CONFIG_EXAMPLE_PROV_MGR_CONNECTION_CNT,
-      },
-#endif
-      /* What is the Provisioning Scheme that we want ?
-       * wifi_prov_scheme_softap or wifi_prov_scheme_ble -> wifi_prov_scheme_softap*/
-      .scheme = wifi_prov_scheme_softap,
-
-      /* WIFI_PROV_EVENT_HANDLER_NONE when using wifi_prov_scheme_softap*/
-      .scheme_event_handler = WIFI_PROV_EVENT_HANDLER_NONE
-  };
-
-  /* Initialize provisioning manager with the
-   * configuration parameters set above */
   step="Initialize provisioning manager";
-  ret=wifi_prov_mgr_init(config);
+  ret=wifi_prov_init();
   if (ret != ESP_OK) goto FNRET;
 
   bool provisioned = false;
@@ -228,32 +535,8 @@ esp_err_t wifi_provision(void)
   /* If device is not yet provisioned start provisioning service */
   if (!provisioned)
   {
-    ESP_LOGI(TAG, "Starting provisioning");
-
-    /* What is the Device Service Name that we want
-     * This translates to :
-     *     - Wi-Fi SSID when scheme is wifi_prov_scheme_softap
-     *     - device name when scheme is wifi_prov_scheme_ble
-     */
-    char service_name[12];
-    get_device_service_name(service_name, sizeof(service_name));
-
-    /* What is the security level that we want (0, 1, 2):
-     *      - WIFI_PROV_SECURITY_0 is simply plain text communication.
-     */
-    wifi_prov_security_t security = WIFI_PROV_SECURITY_0;
-
-    /* What is the service key (could be NULL)
-     * This translates to :
-     *     - Wi-Fi password when scheme is wifi_prov_scheme_softap
-     *          (Minimum expected length: 8, maximum 64 for WPA2-PSK)
-     */
-    const char *service_key = "password";
-
-    /* Start provisioning service */
-    ESP_LOGI(TAG, "starting provisioning...");
     step="Start provisioning service";
-    ret=wifi_prov_mgr_start_provisioning(security, NULL, service_name, service_key);
+    ret=wifi_prov_start();
     if (ret != ESP_OK) goto FNRET;
   }
   else
@@ -271,11 +554,6 @@ esp_err_t wifi_provision(void)
     wifi_init_sta();
   }
 
-  ESP_LOGI(TAG, "Waiting for connection...");
-
-  /* Wait for Wi-Fi connection */
-  xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_EVENT, true, true, portMAX_DELAY);
-
 FNRET:
   if (ret != ESP_OK)
   {
@@ -283,3 +561,16 @@ FNRET:
   }
   return ret;
 }
+
+/* waits until station gets IP address, timeout_ms < 0 waits forever */
+esp_err_t wifi_wait_connected(int timeout_ms)
+{
+  EventBits_t bits;
+
+  if (wifi_event_group == NULL) return ESP_ERR_INVALID_STATE;
+
+  ESP_LOGI(TAG, "Waiting for connection...");
+  bits = xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_EVENT, true, true,
+                             timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+  return (bits & WIFI_CONNECTED_EVENT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
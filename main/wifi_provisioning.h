@@ -1,15 +1,30 @@
 #ifndef __WIFI_PROVISIONING_H
 #define __WIFI_PROVISIONING_H
 
+#include <stddef.h>
+
 #include <esp_err.h>
 
+#include "wifi_conn.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-//initializes and starts wifi provisioning / connection to wifi
+//initializes and starts wifi provisioning / connection to wifi, it does not wait for connection
+//NVS, netif and default event loop must have been initialized
 esp_err_t wifi_provision(void);
 
+//waits until station gets IP address, timeout_ms < 0 waits forever
+esp_err_t wifi_wait_connected(int timeout_ms);
+
+//registers callback of connection state changes, it is called with current state right away
+//callback runs in Wi-Fi event or timer context and must not block
+esp_err_t wifi_conn_listen(void (*cb)(t_wifi_conn_state state, void *arg), void *arg);
+
+//renders connection state and counters, returns length
+size_t wifi_conn_status(char *buf, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_err.h"
+
+#include "discordbot.h"
+#include "latency.h"
+#include "discord_mock.h"
+#include "sim_clock.h"
+#include "sim_task.h"
+#include "dib_clock.h"
+
+//end-to-end latency of door notification: discordbot.c, outbox.c and discord_rest.c run with their tasks on simulated
+//clock against loopback Discord (discord_mock.c), edges are pushed by dib_inject_edge
+//sample is time from edge to arrival of request that delivered its notification, percentiles are exact (nearest rank)
+//gateway delivers READY first, then chatter and !status of another channel between edges, next edge comes
+//0 to BENCH_GAP_MAX_MS after previous notification arrived, so short gaps meet empty rate limit bucket
+//argument is number of edges, results depend on options of discord_mock only, not on machine
+
+#define MS 1000LL
+#define S 1000000LL
+
+//default channel of dbot_e2e (CONFIG_DISCORD_CHANNEL_ID), it gets door changes
+#define BENCH_CHANNEL "1"
+//commands come from here, replies do not share bucket with door changes
+#define BENCH_COMMAND_CHANNEL "2"
+#define BENCH_GAP_MAX_MS 4000
+//one in this many gaps carries !status, others chatter
+#define BENCH_COMMAND_EVERY 4
+//notification not delivered by then is failure
+#define BENCH_TIMEOUT (120 * S)
+
+static char bench_expect[32]; //notification starts with it
+static int64_t bench_arrival; //arrival of expected notification, 0 while waiting
+static int bench_unexpected; //door channel got something else
+static uint32_t bench_seed = 12345;
+
+//helper, xorshift32
+static uint32_t bench_rand(void)
+{
+  bench_seed ^= bench_seed << 13;
+  bench_seed ^= bench_seed >> 17;
+  bench_seed ^= bench_seed << 5;
+  return bench_seed;
+}
+
+//takes first delivered message of door channel while waiting
+static void bench_on_request(const t_discord_mock_request *req)
+{
+  if (req->status != 200 || strcmp(req->route, BENCH_CHANNEL) != 0) return;
+  if (bench_arrival || strncmp(req->content, bench_expect, strlen(bench_expect)) != 0)
+  {
+    fprintf(stderr, "unexpected message \"%s\"\n", req->content);
+    bench_unexpected++;
+    return;
+  }
+  bench_arrival = req->arrival;
+}
+
+//helper, runs bot until expected notification arrives, returns its arrival, -1 on timeout
+static int64_t bench_wait(const char *expect)
+{
+  int64_t deadline = dib_clock_us() + BENCH_TIMEOUT;
+
+  snprintf(bench_expect, sizeof(bench_expect), "%s", expect);
+  bench_arrival = 0;
+  while (bench_arrival == 0 && dib_clock_us() < deadline)
+  {
+    if (sim_task_run(dib_clock_us() + 10 * MS) < 0) return -1;
+  }
+  return bench_arrival ? bench_arrival : -1;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+//helper, nearest-rank percentile of sorted samples
+static int64_t bench_percentile(const int64_t *sorted, long n, int p)
+{
+  long rank = (n * p + 99) / 100;
+
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int main(int argc, char **argv)
+{
+  long n = argc > 1 ? atol(argv[1]) : 10000;
+  int64_t *samples, gap, edge, arrival;
+  char histograms[1024];
+  int open = 0;
+
+  if (n <= 0) n = 1;
+  samples = (int64_t *)malloc(n * sizeof(samples[0]));
+  if (samples == NULL) return 1;
+
+  discord_mock.on_request = bench_on_request;
+  if (dib_init() != ESP_OK || dib_start() != ESP_OK) return 1;
+  sim_task_run(1 * S);
+
+  //gateway is up, bot posts state of sensors
+  if (!discord_mock_ready() || bench_wait("Door is closed") < 0) return 1;
+  latency_reset();
+
+  for (long i = 0; i < n; i++)
+  {
+    //previous notification has arrived, next edge comes after gap, chat message somewhere in between
+    gap = (int64_t)(bench_rand() % (BENCH_GAP_MAX_MS + 1)) * MS;
+    edge = dib_clock_us() + gap;
+    sim_task_run(dib_clock_us() + (gap ? bench_rand() % gap : 0));
+    if (bench_rand() % BENCH_COMMAND_EVERY == 0) discord_mock_message(BENCH_COMMAND_CHANNEL, "!status", 0);
+    else discord_mock_message(BENCH_CHANNEL, "the door again?", 0);
+    sim_task_run(edge);
+
+    open = !open;
+    if (dib_inject_edge(0, open) != ESP_OK) return 1;
+    arrival = bench_wait(open ? "Door is OPEN" : "Door is closed");
+    if (arrival < 0)
+    {
+      fprintf(stderr, "edge %ld at %lld us was not delivered\n", i, (long long)edge);
+      return 1;
+    }
+    samples[i] = arrival - edge;
+    //bot is done with it, edge of the same level would not be a change
+    sim_task_run(arrival);
+  }
+  //last response comes back, so that bot histograms below cover every edge
+  sim_task_run(dib_clock_us() + 1 * S);
+
+  qsort(samples, n, sizeof(samples[0]), bench_cmp);
+  printf("edge to request arrival, %ld edges: min %.1f ms, p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n", n,
+    samples[0] / 1000.0, bench_percentile(samples, n, 50) / 1000.0, bench_percentile(samples, n, 90) / 1000.0,
+    bench_percentile(samples, n, 99) / 1000.0, samples[n - 1] / 1000.0);
+  printf("requests %d, rate limited %d, connections %d, simulated %.1f s\n", discord_mock.requests, discord_mock.limited,
+    discord_mock.connects, dib_clock_us() / 1e6);
+  printf("bot histograms (1-2-5 bucket bounds):\n");
+  latency_render(histograms, sizeof(histograms));
+  printf("%s\n", histograms);
+
+  free(samples);
+  return bench_unexpected ? 1 : 0;
+}
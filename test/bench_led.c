@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "led_task.h"
+#include "led_backend_mock.h"
+#include "sim_clock.h"
+#include "sim_task.h"
+#include "dib_clock.h"
+
+//micro-benchmarks of LED task paths on simulated scheduler, prints ns per call
+//task cycle includes context switches of sim_task.c, compare numbers of the same machine only
+//argument is number of iterations
+
+//helper, monotonic time in ns
+static int64_t bench_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, long n, int64_t ns)
+{
+  printf("%-28s %8.1f ns/call (%ld calls)\n", name, (double)ns / n, n);
+}
+
+//producer side, lock-free push into ring, ring is drained by task between rounds
+static void bench_push(void *h, long n)
+{
+  int64_t ns = 0, t0;
+  long done = 0;
+
+  while (done < n)
+  {
+    t0 = bench_ns();
+    for (int i = 0; i < 8; i++) led_push_action(h, (i & 1) ? LED_ON : LED_OFF, -1);
+    ns += bench_ns() - t0;
+    done += 8;
+    sim_task_run(dib_clock_us());
+    led_mock_clear();
+  }
+  bench_report("led_push_action", done, ns);
+}
+
+//push and task cycle taking it over and showing it
+static void bench_push_take(void *h, long n)
+{
+  int64_t t0 = bench_ns();
+
+  for (long i = 0; i < n; i++)
+  {
+    led_push_action(h, (i & 1) ? LED_ON : LED_OFF, -1);
+    sim_task_run(dib_clock_us());
+    led_mock_clear();
+  }
+  bench_report("led push+task cycle", n, bench_ns() - t0);
+}
+
+//task cycle performing one step of running pattern
+static void bench_update(void *h, long n)
+{
+  int64_t t0;
+
+  led_push_action(h, LED_BLINKING_ANGRY, -1);
+  sim_task_run(dib_clock_us());
+  t0 = bench_ns();
+  for (long i = 0; i < n; i++)
+  {
+    sim_task_run(dib_clock_us() + 100000);
+    led_mock_clear();
+  }
+  bench_report("led task update cycle", n, bench_ns() - t0);
+}
+
+int main(int argc, char **argv)
+{
+  long n = argc > 1 ? atol(argv[1]) : 1000000;
+  void *h;
+
+  if (n <= 0) n = 1;
+  h = led_init(2, 1);
+  if (h == NULL) return 1;
+  sim_task_run(dib_clock_us());
+
+  bench_push(h, n);
+  bench_push_take(h, n);
+  bench_update(h, n);
+
+  led_deinit(h);
+  sim_task_run(dib_clock_us());
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "command.h"
+#include "debounce.h"
+#include "led_pattern.h"
+#include "rate_limit.h"
+#include "relay_ring.h"
+
+//micro-benchmarks of hot paths, prints ns per call, compare numbers of the same machine only
+//argument is number of iterations
+
+//keeps results alive, so that compiler does not drop benchmarked code
+static volatile long bench_sink;
+
+//helper, monotonic time in ns
+static int64_t bench_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, long n, int64_t ns)
+{
+  printf("%-28s %8.1f ns/call (%ld calls)\n", name, (double)ns / n, n);
+}
+
+//ISR push and relay task pop of one edge
+static void bench_relay_ring(long n)
+{
+  static t_relay_ring ring;
+  t_relay_edge e = {0};
+  int64_t t0 = bench_ns();
+
+  for (long i = 0; i < n; i++)
+  {
+    relay_ring_push(&ring, i & 7, i, i & 1);
+    bench_sink += relay_ring_pop(&ring, &e);
+  }
+  bench_report("relay_ring push+pop", n, bench_ns() - t0);
+}
+
+//relay task feeding bouncing edges to debounce
+static void bench_debounce(long n)
+{
+  t_debounce d;
+  t_debounce_event ev;
+  int64_t t0;
+
+  debounce_init(&d, 0, 20000);
+  t0 = bench_ns();
+  for (long i = 0; i < n; i++)
+  {
+    bench_sink += debounce_edge(&d, i & 1, i * 7000, &ev);
+    bench_sink += debounce_poll(&d, i * 7000 + 3000, &ev);
+  }
+  bench_report("debounce edge+poll", n, bench_ns() - t0);
+}
+
+//led task update step of endless pattern
+static void bench_led_pattern(long n)
+{
+  const t_led_pattern *p = led_pattern_get(LED_SOS);
+  t_led_cursor c;
+  int64_t t0;
+
+  led_pattern_start(&c, -1);
+  t0 = bench_ns();
+  for (long i = 0; i < n; i++) bench_sink += led_pattern_next(p, &c)->duration;
+  bench_report("led_pattern_next", n, bench_ns() - t0);
+}
+
+//sender check of bucket before every request
+static void bench_rate_limit(long n)
+{
+  static const char *routes[] = {"111", "222", "333", "444", "555", "666", "777", "888"};
+  t_rate_limit *rl;
+  int64_t t0 = bench_ns();
+
+  for (long i = 0; i < n; i++)
+  {
+    rl = rate_limit_route(routes[i & 7], i);
+    bench_sink += rate_limit_wait(rl, i);
+    rate_limit_consume(rl, i);
+  }
+  bench_report("rate_limit route+wait+take", n, bench_ns() - t0);
+}
+
+//gateway handler lookup of command name
+static void bench_command(long n)
+{
+  static const char *texts[] = {"!status", "!history", "!subscribe Door", "hello there", "!nope"};
+  const char *args;
+  int64_t t0 = bench_ns();
+
+  for (long i = 0; i < n; i++) bench_sink += command_parse(texts[i % 5], &args);
+  bench_report("command_parse", n, bench_ns() - t0);
+}
+
+int main(int argc, char **argv)
+{
+  long n = argc > 1 ? atol(argv[1]) : 1000000;
+
+  if (n <= 0) n = 1;
+  bench_relay_ring(n);
+  bench_debounce(n);
+  bench_led_pattern(n);
+  bench_rate_limit(n);
+  bench_command(n);
+  return 0;
+}
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "discord.h"
+#include "discord/session.h"
+#include "discord/message.h"
+
+#include "dib_clock.h"
+#include "sim_task.h"
+#include "discord_mock.h"
+
+//limits of Discord, 50 ms of network each way and 20 to 150 ms of server time
+t_discord_mock discord_mock={
+  .limit=5,
+  .window=5000000,
+  .latency=50000,
+  .handshake=300000,
+  .server_min=20000,
+  .server_max=150000,
+  .seed=1,
+};
+
+/***************************************************** */
+/** REST */
+
+#define DISCORD_MOCK_URL_MAX 256
+//body of discord_rest.c fits 2000 escaped chars
+#define DISCORD_MOCK_BODY_MAX 4096
+#define DISCORD_MOCK_RESPONSE_MAX 256
+#define DISCORD_MOCK_HEADERS 4
+
+struct esp_http_client
+{
+  char url[DISCORD_MOCK_URL_MAX];
+  esp_http_client_method_t method;
+  http_event_handle_cb event_handler;
+  void *user_data;
+  int connected;
+
+  //exchange in progress
+  t_discord_mock_request req;
+  int64_t server_time;
+  char headers[DISCORD_MOCK_HEADERS][2][32];
+  int headers_len;
+  char response[DISCORD_MOCK_RESPONSE_MAX];
+};
+
+static uint64_t discord_mock_next_id=1000000000000000000ULL;
+
+//helper, draws server time of request
+static int64_t discord_mock_server_time(void)
+{
+  uint32_t x=discord_mock.seed ? discord_mock.seed : 1;
+
+  //xorshift32
+  x^=x<<13;
+  x^=x>>17;
+  x^=x<<5;
+  discord_mock.seed=x;
+  if(discord_mock.server_max<=discord_mock.server_min) return discord_mock.server_min;
+  return discord_mock.server_min+(int64_t)(x%(uint32_t)(discord_mock.server_max-discord_mock.server_min+1));
+}
+
+//helper, copies path segment at p into out, returns pointer behind it, NULL when it is empty or too long
+static const char *discord_mock_segment(const char *p, char *out, size_t size)
+{
+  size_t len=strcspn(p, "/?");
+
+  if(len == 0 || len>=size) return NULL;
+  memcpy(out, p, len);
+  out[len]=0;
+  return p+len;
+}
+
+//helper, finds route of message request, returns 0 when path is not one of Discord messages
+//channel: POST /api/v10/channels/<id>/messages, PATCH .../messages/<message>
+//webhook: POST /api/webhooks/<id>/<token>, PATCH .../messages/<message>
+static int discord_mock_route(const char *url, esp_http_client_method_t method, char *route, size_t size)
+{
+  char token[128], message[32];
+  const char *p=strstr(url, "://");
+  int edit;
+
+  p=p ? strchr(p+3, '/') : NULL;
+  if(p == NULL || strncmp(p, "/api/", 5)) return 0;
+  p+=5;
+  if(p[0] == 'v')
+  {
+    p+=strcspn(p, "/");
+    if(strncmp(p, "/channels/", 10)) return 0;
+    p=discord_mock_segment(p+10, route, size);
+    if(p == NULL || strncmp(p, "/messages", 9)) return 0;
+    p+=9;
+  }
+  else
+  {
+    if(strncmp(p, "webhooks/", 9)) return 0;
+    p=discord_mock_segment(p+9, route, size);
+    if(p == NULL || *p!='/') return 0;
+    p=discord_mock_segment(p+1, token, sizeof(token));
+    if(p == NULL) return 0;
+    if(strncmp(p, "/messages", 9) == 0) p+=9;
+    else if(*p == 0 || *p == '?') return method == HTTP_METHOD_POST;
+    else return 0;
+  }
+
+  edit=*p == '/';
+  if(edit && (p=discord_mock_segment(p+1, message, sizeof(message))) == NULL) return 0;
+  if(*p!=0 && *p!='?') return 0;
+  return method == (edit ? HTTP_METHOD_PATCH : HTTP_METHOD_POST);
+}
+
+//helper, unescapes content of {"content":"..."} into out, longer content is cut
+static void discord_mock_content(const char *body, char *out, size_t size)
+{
+  const char *p=strstr(body, "\"content\":\"");
+  size_t len=0;
+
+  out[0]=0;
+  if(p == NULL) return;
+  for(p+=11;*p && *p!='"' && len<size-1;p++)
+  {
+    if(*p == '\\' && p[1])
+    {
+      p++;
+      if(*p == 'n')
+      {
+        out[len++]='\n';
+      }
+      else if(*p == 'u')
+      {
+        //\u00XX of control char is shown as '?'
+        for(int i=0;i<4 && p[1];i++) p++;
+        out[len++]='?';
+      }
+      else
+      {
+        out[len++]=*p;
+      }
+    }
+    else
+    {
+      out[len++]=*p;
+    }
+  }
+  out[len]=0;
+}
+
+//helper, returns bucket of route, the least recently reset one is reused when table is full
+static t_discord_mock_bucket *discord_mock_bucket(const char *route)
+{
+  t_discord_mock_bucket *b, *oldest=&discord_mock.buckets[0];
+
+  for(int i=0;i<DISCORD_MOCK_ROUTES_MAX;i++)
+  {
+    b=&discord_mock.buckets[i];
+    if(strcmp(b->route, route) == 0) return b;
+    if(b->reset_at<oldest->reset_at) oldest=b;
+  }
+  memset(oldest, 0, sizeof(*oldest));
+  snprintf(oldest->route, sizeof(oldest->route), "%s", route);
+  oldest->remaining=discord_mock.limit;
+  return oldest;
+}
+
+//helper, adds response header
+static void discord_mock_header(esp_http_client_handle_t client, const char *key, const char *fmt, double value)
+{
+  if(client->headers_len>=DISCORD_MOCK_HEADERS) return;
+  snprintf(client->headers[client->headers_len][0], sizeof(client->headers[0][0]), "%s", key);
+  snprintf(client->headers[client->headers_len][1], sizeof(client->headers[0][1]), fmt, value);
+  client->headers_len++;
+}
+
+//server side, answers request at its arrival
+static void discord_mock_serve(esp_http_client_handle_t client)
+{
+  t_discord_mock_request *req=&client->req;
+  t_discord_mock_bucket *b;
+  int64_t now=req->arrival;
+  double reset_after;
+
+  client->headers_len=0;
+  discord_mock.requests++;
+
+  if(!req->route[0])
+  {
+    req->status=404;
+    snprintf(client->response, sizeof(client->response), "{\"message\":\"404: Not Found\",\"code\":0}");
+  }
+  else
+  {
+    b=discord_mock_bucket(req->route);
+    if(b->reset_at && now>=b->reset_at)
+    {
+      b->remaining=discord_mock.limit;
+      b->reset_at=0;
+    }
+    if(!b->reset_at) b->reset_at=now+discord_mock.window;
+    reset_after=(b->reset_at-now)/1000000.0;
+
+    discord_mock_header(client, "X-RateLimit-Limit", "%.0f", discord_mock.limit);
+    if(b->remaining>0)
+    {
+      b->remaining--;
+      req->status=200;
+      snprintf(client->response, sizeof(client->response), "{\"id\":\"%llu\",\"channel_id\":\"%s\"}",
+        (unsigned long long)++discord_mock_next_id, req->route);
+    }
+    else
+    {
+      req->status=429;
+      discord_mock.limited++;
+      discord_mock_header(client, "Retry-After", "%.3f", reset_after);
+      snprintf(client->response, sizeof(client->response),
+        "{\"message\":\"You are being rate limited.\",\"retry_after\":%.3f,\"global\":false}", reset_after);
+    }
+    discord_mock_header(client, "X-RateLimit-Remaining", "%.0f", b->remaining);
+    discord_mock_header(client, "X-RateLimit-Reset-After", "%.3f", reset_after);
+  }
+
+  if(discord_mock.on_request) discord_mock.on_request(req);
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+  return ESP_OK;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *cfg)
+{
+  esp_http_client_handle_t client=calloc(1, sizeof(*client));
+
+  if(client == NULL) return NULL;
+  if(cfg->crt_bundle_attach) cfg->crt_bundle_attach(NULL);
+  esp_http_client_set_url(client, cfg->url);
+  client->event_handler=cfg->event_handler;
+  client->user_data=cfg->user_data;
+  return client;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+  free(client);
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+  client->url[0]=0;
+  strncat(client->url, url, sizeof(client->url)-1);
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+  client->method=method;
+  return ESP_OK;
+}
+
+//headers of request are not checked
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data)
+{
+  client->user_data=data;
+  return ESP_OK;
+}
+
+//kept-alive connection is reused, new one costs handshake
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+  if(!client->connected)
+  {
+    discord_mock.connects++;
+    sim_task_sleep(discord_mock.handshake);
+    client->connected=1;
+  }
+  return ESP_OK;
+}
+
+//request leaves client, server answers it when it arrives
+int esp_http_client_write(esp_http_client_handle_t client, const char *buf, int len)
+{
+  t_discord_mock_request *req=&client->req;
+  char body[DISCORD_MOCK_BODY_MAX];
+
+  snprintf(body, sizeof(body), "%.*s", len, buf);
+  memset(req, 0, sizeof(*req));
+  req->method=client->method;
+  if(!discord_mock_route(client->url, client->method, req->route, sizeof(req->route))) req->route[0]=0;
+  discord_mock_content(body, req->content, sizeof(req->content));
+  req->sent=dib_clock_us();
+  req->arrival=req->sent+discord_mock.latency;
+  client->server_time=discord_mock_server_time();
+
+  discord_mock_serve(client);
+  return len;
+}
+
+//response headers come back after server time and return trip
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+  esp_http_client_event_t evt;
+
+  sim_task_sleep(client->req.arrival+client->server_time+discord_mock.latency-dib_clock_us());
+
+  for(int i=0;i<client->headers_len && client->event_handler;i++)
+  {
+    memset(&evt, 0, sizeof(evt));
+    evt.event_id=HTTP_EVENT_ON_HEADER;
+    evt.client=client;
+    evt.user_data=client->user_data;
+    evt.header_key=client->headers[i][0];
+    evt.header_value=client->headers[i][1];
+    client->event_handler(&evt);
+  }
+  return (int64_t)strlen(client->response);
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+  return client->req.status;
+}
+
+int esp_http_client_read_response(esp_http_client_handle_t client, char *buf, int len)
+{
+  int n=(int)strlen(client->response);
+
+  if(n>len) n=len;
+  memcpy(buf, client->response, n);
+  return n;
+}
+
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len)
+{
+  if(len) *len=0;
+  return ESP_OK;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+  client->connected=0;
+  return ESP_OK;
+}
+
+/***************************************************** */
+/** GATEWAY */
+
+#define DISCORD_MOCK_HANDLERS_MAX 8
+
+typedef struct _t_discord_mock_handler
+{
+  discord_event_t event;
+  esp_event_handler_t handler;
+  void *arg;
+} t_discord_mock_handler;
+
+struct discord
+{
+  discord_config_t config;
+  t_discord_mock_handler handlers[DISCORD_MOCK_HANDLERS_MAX];
+  int handlers_len;
+};
+
+static struct discord discord_mock_bot;
+
+discord_handle_t discord_create(const discord_config_t *config)
+{
+  memset(&discord_mock_bot, 0, sizeof(discord_mock_bot));
+  discord_mock_bot.config=*config;
+  return &discord_mock_bot;
+}
+
+esp_err_t discord_register_events(discord_handle_t handle, discord_event_t event, esp_event_handler_t handler, void *arg)
+{
+  t_discord_mock_handler *h;
+
+  if(handle->handlers_len>=DISCORD_MOCK_HANDLERS_MAX) return ESP_ERR_NO_MEM;
+  h=&handle->handlers[handle->handlers_len++];
+  h->event=event;
+  h->handler=handler;
+  h->arg=arg;
+  return ESP_OK;
+}
+
+esp_err_t discord_login(discord_handle_t handle)
+{
+  discord_mock.logged_in=1;
+  return ESP_OK;
+}
+
+//helper, calls handlers of event as gateway task of esp-discord does
+static void discord_mock_dispatch(discord_event_t event, void *ptr)
+{
+  discord_event_data_t data={ .client=&discord_mock_bot, .ptr=ptr };
+  t_discord_mock_handler *h;
+
+  for(int i=0;i<discord_mock_bot.handlers_len;i++)
+  {
+    h=&discord_mock_bot.handlers[i];
+    if(h->event == event || h->event == DISCORD_EVENT_ANY) h->handler(h->arg, "DISCORD_EVENTS", event, &data);
+  }
+}
+
+//delivers READY (DISCORD_EVENT_CONNECTED), returns 0 when bot has not logged in
+int discord_mock_ready(void)
+{
+  discord_user_t user={ .id="100", .bot=true, .username="guard", .discriminator="0001" };
+  discord_session_t session={ .session_id="mock", .user=&user };
+
+  if(!discord_mock.logged_in) return 0;
+  discord_mock_dispatch(DISCORD_EVENT_CONNECTED, &session);
+  return 1;
+}
+
+//delivers MESSAGE_CREATE (DISCORD_EVENT_MESSAGE_RECEIVED), message is gone when handlers return, as in esp-discord
+int discord_mock_message(const char *channel_id, const char *content, int author_bot)
+{
+  char id[24], channel[DISCORD_MOCK_ROUTE_MAX], text[DISCORD_MOCK_CONTENT_MAX];
+  discord_user_t author={ .id="200", .bot=author_bot, .username="someone", .discriminator="0002" };
+  discord_message_t msg={ .id=id, .content=text, .channel_id=channel, .author=&author, .guild_id="300" };
+
+  if(!discord_mock.logged_in) return 0;
+  snprintf(id, sizeof(id), "%llu", (unsigned long long)++discord_mock_next_id);
+  snprintf(channel, sizeof(channel), "%s", channel_id);
+  snprintf(text, sizeof(text), "%s", content);
+  discord_mock_dispatch(DISCORD_EVENT_MESSAGE_RECEIVED, &msg);
+  return 1;
+}
@@ -0,0 +1,74 @@
+#ifndef __DISCORD_MOCK_H
+#define __DISCORD_MOCK_H
+
+#include <stdint.h>
+
+#include "esp_http_client.h"
+
+//loopback Discord of host build, runs on simulated clock in process, no socket is opened
+//REST: esp_http_client requests are answered with token bucket per route and X-RateLimit-* headers as Discord does,
+//empty bucket answers 429 with Retry-After, request and response travel for latency each
+//gateway: esp-discord is stubbed, discord_mock_ready and discord_mock_message deliver READY and MESSAGE_CREATE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISCORD_MOCK_ROUTE_MAX 24
+#define DISCORD_MOCK_CONTENT_MAX 256
+#define DISCORD_MOCK_ROUTES_MAX 16
+
+//request as server got it
+typedef struct _t_discord_mock_request
+{
+  esp_http_client_method_t method;
+  char route[DISCORD_MOCK_ROUTE_MAX]; //channel or webhook id, empty when path is not known
+  char content[DISCORD_MOCK_CONTENT_MAX]; //unescaped content, longer one is cut
+  int64_t sent; //dib_clock_us() when client wrote body
+  int64_t arrival; //when server got it, sent + latency
+  int status; //answer of server
+} t_discord_mock_request;
+
+//token bucket of route, window starts with first request
+typedef struct _t_discord_mock_bucket
+{
+  char route[DISCORD_MOCK_ROUTE_MAX];
+  int remaining;
+  int64_t reset_at; //0 before first request of window
+} t_discord_mock_bucket;
+
+typedef struct _t_discord_mock
+{
+  //options, tests set them before first request
+  int limit; //requests per window and route (Discord: 5)
+  int64_t window; //bucket window, us (Discord: 5 s)
+  int64_t latency; //one way network time, us
+  int64_t handshake; //setting up new (TLS) connection, us
+  int64_t server_min; //server time of request is drawn from <server_min, server_max>, us
+  int64_t server_max;
+  uint32_t seed; //of server time draws
+  void (*on_request)(const t_discord_mock_request *req); //called when request is answered, may be NULL
+
+  //what happened
+  int requests;
+  int limited; //answered 429
+  int connects; //connections set up
+  int logged_in; //discord_login was called
+
+  t_discord_mock_bucket buckets[DISCORD_MOCK_ROUTES_MAX];
+} t_discord_mock;
+
+extern t_discord_mock discord_mock;
+
+//delivers READY (DISCORD_EVENT_CONNECTED), returns 0 when bot has not logged in
+int discord_mock_ready(void);
+
+//delivers MESSAGE_CREATE (DISCORD_EVENT_MESSAGE_RECEIVED) of content in channel, author_bot marks message of a bot
+//returns 0 when bot has not logged in
+int discord_mock_message(const char *channel_id, const char *content, int author_bot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __HOST_DISCORD_H
+#define __HOST_DISCORD_H
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+//esp-discord API used by the bot, gateway of host build is stubbed by discord_mock.c
+//tests deliver READY and MESSAGE_CREATE through discord_mock_ready and discord_mock_message
+
+typedef struct discord *discord_handle_t;
+
+typedef enum _t_host_discord_intent
+{
+  DISCORD_INTENT_GUILD_MESSAGES = 1 << 9,
+  DISCORD_INTENT_MESSAGE_CONTENT = 1 << 15
+} discord_intent_t;
+
+typedef struct _t_host_discord_config
+{
+  int intents;
+  char *token;
+} discord_config_t;
+
+typedef enum _t_host_discord_event
+{
+  DISCORD_EVENT_ANY = -1,
+  DISCORD_EVENT_CONNECTED = 0,
+  DISCORD_EVENT_MESSAGE_RECEIVED,
+  DISCORD_EVENT_MESSAGE_UPDATED,
+  DISCORD_EVENT_MESSAGE_DELETED,
+  DISCORD_EVENT_DISCONNECTED
+} discord_event_t;
+
+typedef struct _t_host_discord_event_data
+{
+  discord_handle_t client;
+  void *ptr;
+} discord_event_data_t;
+
+#define DISCORD_EMOJI_X ":x:"
+#define DISCORD_EMOJI_WHITE_CHECK_MARK ":white_check_mark:"
+
+discord_handle_t discord_create(const discord_config_t *config);
+esp_err_t discord_register_events(discord_handle_t handle, discord_event_t event, esp_event_handler_t handler, void *arg);
+esp_err_t discord_login(discord_handle_t handle);
+
+#endif
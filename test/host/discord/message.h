@@ -0,0 +1,17 @@
+#ifndef __HOST_DISCORD_MESSAGE_H
+#define __HOST_DISCORD_MESSAGE_H
+
+#include "discord/session.h"
+
+//message of MESSAGE_CREATE, esp-discord subset
+
+typedef struct _t_host_discord_message
+{
+  char *id;
+  char *content;
+  char *channel_id;
+  discord_user_t *author;
+  char *guild_id;
+} discord_message_t;
+
+#endif
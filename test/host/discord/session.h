@@ -0,0 +1,22 @@
+#ifndef __HOST_DISCORD_SESSION_H
+#define __HOST_DISCORD_SESSION_H
+
+#include <stdbool.h>
+
+//session of READY, esp-discord subset
+
+typedef struct _t_host_discord_user
+{
+  char *id;
+  bool bot;
+  char *username;
+  char *discriminator;
+} discord_user_t;
+
+typedef struct _t_host_discord_session
+{
+  char *session_id;
+  discord_user_t *user;
+} discord_session_t;
+
+#endif
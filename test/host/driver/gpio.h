@@ -0,0 +1,48 @@
+#ifndef __HOST_DRIVER_GPIO_H
+#define __HOST_DRIVER_GPIO_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+//GPIO of host build (host_idf.c), inputs read what host_gpio_set left there, ISR handlers are called by host_gpio_set
+
+#define HOST_GPIO_MAX 48
+
+typedef int gpio_num_t;
+
+typedef enum _t_host_gpio_int_type
+{
+  GPIO_INTR_DISABLE = 0,
+  GPIO_INTR_ANYEDGE = 3
+} gpio_int_type_t;
+
+typedef enum _t_host_gpio_mode
+{
+  GPIO_MODE_INPUT = 1,
+  GPIO_MODE_OUTPUT = 2
+} gpio_mode_t;
+
+typedef struct _t_host_gpio_config
+{
+  uint64_t pin_bit_mask;
+  gpio_mode_t mode;
+  int pull_up_en;
+  int pull_down_en;
+  gpio_int_type_t intr_type;
+} gpio_config_t;
+
+typedef void (*gpio_isr_t)(void *arg);
+
+#define BIT64(n) (1ULL << (n))
+
+esp_err_t gpio_config(const gpio_config_t *cfg);
+int gpio_get_level(gpio_num_t gpio);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+esp_err_t gpio_install_isr_service(int flags);
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void *arg);
+
+//changes input level as hardware would, handler of pin is called in simulated ISR context
+void host_gpio_set(gpio_num_t gpio, int level);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef __HOST_ESP_CRT_BUNDLE_H
+#define __HOST_ESP_CRT_BUNDLE_H
+
+#include "esp_err.h"
+
+//there is no TLS in host build, loopback Discord (discord_mock.c) only records that bundle was attached
+
+esp_err_t esp_crt_bundle_attach(void *conf);
+
+#endif
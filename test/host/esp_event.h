@@ -0,0 +1,13 @@
+#ifndef __HOST_ESP_EVENT_H
+#define __HOST_ESP_EVENT_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+//event types of ESP-IDF, events of host build are dispatched by the mocks that raise them
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *handler_arg, esp_event_base_t base, int32_t event_id, void *event_data);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __HOST_ESP_SYSTEM_H
+#define __HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+//heap figures of host build (host_idf.c) are 0, there is no heap of the device to sample
+
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef __HOST_ESP_TASK_H
+#define __HOST_ESP_TASK_H
+
+//nothing of esp_task.h is used by host-built modules
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __HOST_FREERTOS_H
+#define __HOST_FREERTOS_H
+
+#include <stdint.h>
+
+//FreeRTOS subset of host build, task functions are simulated by sim_task.c, semaphores by host_idf.c
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+//default CONFIG_FREERTOS_HZ of ESP-IDF is 100
+#ifndef portTICK_PERIOD_MS
+#define portTICK_PERIOD_MS 10
+#endif
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) / portTICK_PERIOD_MS)
+
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+//simulated tasks never preempt each other, critical sections have nothing to exclude
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define taskENTER_CRITICAL(mux) ((void)(mux))
+#define taskEXIT_CRITICAL(mux) ((void)(mux))
+#define taskENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define taskEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+//comes from esp_attr.h through port headers on device
+#define IRAM_ATTR
+
+//FreeRTOSConfig.h of ESP-IDF
+#define configMAX_TASK_NAME_LEN 16
+
+//tests may pretend ISR context
+extern int sim_task_in_isr;
+#define xPortInIsrContext() (sim_task_in_isr)
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __HOST_FREERTOS_PROJDEFS_H
+#define __HOST_FREERTOS_PROJDEFS_H
+
+//pdMS_TO_TICKS and pdTRUE of host build are in FreeRTOS.h, as it includes projdefs.h on device
+#include "freertos/FreeRTOS.h"
+
+#endif
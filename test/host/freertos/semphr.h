@@ -0,0 +1,20 @@
+#ifndef __HOST_FREERTOS_SEMPHR_H
+#define __HOST_FREERTOS_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+//mutexes of host build (host_idf.c), taking held one blocks simulated task until it is given back
+
+typedef struct _t_host_mutex
+{
+  int taken;
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#endif
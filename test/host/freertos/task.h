@@ -0,0 +1,16 @@
+#ifndef __HOST_FREERTOS_TASK_H
+#define __HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+//task functions of host build, sim_task.c runs tasks cooperatively on simulated clock
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, unsigned int prio, TaskHandle_t *handle);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelay(TickType_t ticks);
+void vTaskSuspend(TaskHandle_t task);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __HOST_NVS_FLASH_H
+#define __HOST_NVS_FLASH_H
+
+#include "nvs.h"
+
+//in-memory NVS of host build needs no partition init
+
+#endif
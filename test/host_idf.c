@@ -0,0 +1,285 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "nvs.h"
+#include "driver/gpio.h"
+
+#include "sim_task.h"
+
+//ESP-IDF services of host build that are not tied to the clock, the ones that are live in sim_task.c
+
+/***************************************************** */
+/** LOG AND HEAP */
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+  va_list args;
+
+  if(level>ESP_LOG_WARN) return;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+  return 0;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+  return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+  return 0;
+}
+
+/***************************************************** */
+/** MUTEX */
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  return (SemaphoreHandle_t)calloc(1, sizeof(StaticSemaphore_t));
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf)
+{
+  buf->taken=0;
+  return buf;
+}
+
+//held mutex can be met only when its holder is blocked, waiting task polls it every tick
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+  while(sem->taken)
+  {
+    if(wait == 0) return pdFALSE;
+    if(xTaskGetCurrentTaskHandle() == NULL)
+    {
+      //test code or timer callback would wait for ever
+      fprintf(stderr, "host_idf: mutex %p is held by blocked task\n", (void *)sem);
+      abort();
+    }
+    sim_task_sleep(portTICK_PERIOD_MS*1000);
+    if(wait!=portMAX_DELAY) wait--;
+  }
+  sem->taken=1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+  if(!sem->taken) return pdFALSE;
+  sem->taken=0;
+  return pdTRUE;
+}
+
+/***************************************************** */
+/** NVS */
+
+//entries of all namespaces, enough for subscribers and journal of SENSORS_MAX sensors
+#define HOST_NVS_ENTRIES 128
+#define HOST_NVS_NAMESPACES 8
+#define HOST_NVS_NAME_MAX 16
+
+typedef struct _t_host_nvs_entry
+{
+  nvs_handle_t ns; //0 for free entry
+  char key[HOST_NVS_NAME_MAX];
+  void *value;
+  size_t len;
+} t_host_nvs_entry;
+
+static char host_nvs_names[HOST_NVS_NAMESPACES][HOST_NVS_NAME_MAX];
+static t_host_nvs_entry host_nvs[HOST_NVS_ENTRIES];
+
+//handle is namespace index + 1, namespace is created on first open
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+  int i;
+
+  for(i=0;i<HOST_NVS_NAMESPACES && host_nvs_names[i][0];i++)
+  {
+    if(strcmp(host_nvs_names[i], name) == 0) break;
+  }
+  if(i>=HOST_NVS_NAMESPACES) return ESP_ERR_NO_MEM;
+  if(!host_nvs_names[i][0])
+  {
+    if(mode == NVS_READONLY) return ESP_ERR_NVS_NOT_FOUND;
+    strncat(host_nvs_names[i], name, HOST_NVS_NAME_MAX-1);
+  }
+  *handle=(nvs_handle_t)(i+1);
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+  return ESP_OK;
+}
+
+//helper, returns entry of key, NULL when there is none
+static t_host_nvs_entry *host_nvs_find(nvs_handle_t handle, const char *key)
+{
+  for(int i=0;i<HOST_NVS_ENTRIES;i++)
+  {
+    if(host_nvs[i].ns == handle && strcmp(host_nvs[i].key, key) == 0) return &host_nvs[i];
+  }
+  return NULL;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+  t_host_nvs_entry *e=host_nvs_find(handle, key);
+
+  if(e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+  free(e->value);
+  memset(e, 0, sizeof(*e));
+  return ESP_OK;
+}
+
+//helper, stores copy of value under key
+static esp_err_t host_nvs_set(nvs_handle_t handle, const char *key, const void *value, size_t len)
+{
+  t_host_nvs_entry *e=host_nvs_find(handle, key);
+  void *copy;
+
+  for(int i=0;e == NULL && i<HOST_NVS_ENTRIES;i++)
+  {
+    if(host_nvs[i].ns == 0) e=&host_nvs[i];
+  }
+  if(e == NULL) return ESP_ERR_NO_MEM;
+
+  copy=malloc(len ? len : 1);
+  if(copy == NULL) return ESP_ERR_NO_MEM;
+  memcpy(copy, value, len);
+
+  free(e->value);
+  e->ns=handle;
+  e->key[0]=0;
+  strncat(e->key, key, HOST_NVS_NAME_MAX-1);
+  e->value=copy;
+  e->len=len;
+  return ESP_OK;
+}
+
+//helper, copies value of key of exactly len bytes
+static esp_err_t host_nvs_get(nvs_handle_t handle, const char *key, void *value, size_t len)
+{
+  t_host_nvs_entry *e=host_nvs_find(handle, key);
+
+  if(e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+  if(e->len!=len) return ESP_ERR_NVS_INVALID_LENGTH;
+  memcpy(value, e->value, len);
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+  return host_nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value)
+{
+  return host_nvs_get(handle, key, value, sizeof(*value));
+}
+
+esp_err_t nvs_set_u64(nvs_handle_t handle, const char *key, uint64_t value)
+{
+  return host_nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u64(nvs_handle_t handle, const char *key, uint64_t *value)
+{
+  return host_nvs_get(handle, key, value, sizeof(*value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+  return host_nvs_set(handle, key, value, strlen(value)+1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t len)
+{
+  return host_nvs_set(handle, key, value, len);
+}
+
+//string and blob, value NULL asks for length only
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *len)
+{
+  t_host_nvs_entry *e=host_nvs_find(handle, key);
+
+  if(e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+  if(value && *len<e->len) return ESP_ERR_NVS_INVALID_LENGTH;
+  if(value) memcpy(value, e->value, e->len);
+  *len=e->len;
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value, size_t *len)
+{
+  return nvs_get_blob(handle, key, value, len);
+}
+
+/***************************************************** */
+/** GPIO */
+
+static int host_gpio_levels[HOST_GPIO_MAX];
+static gpio_isr_t host_gpio_handlers[HOST_GPIO_MAX];
+static void *host_gpio_args[HOST_GPIO_MAX];
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+  if(cfg->pin_bit_mask == 0 || cfg->pin_bit_mask>>HOST_GPIO_MAX) return ESP_ERR_INVALID_ARG;
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+  return (gpio>=0 && gpio<HOST_GPIO_MAX) ? host_gpio_levels[gpio] : 0;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+  if(gpio<0 || gpio>=HOST_GPIO_MAX) return ESP_ERR_INVALID_ARG;
+  host_gpio_levels[gpio]=!!level;
+  return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+  return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void *arg)
+{
+  if(gpio<0 || gpio>=HOST_GPIO_MAX) return ESP_ERR_INVALID_ARG;
+  host_gpio_handlers[gpio]=handler;
+  host_gpio_args[gpio]=arg;
+  return ESP_OK;
+}
+
+//changes input level as hardware would, handler of pin is called in simulated ISR context
+void host_gpio_set(gpio_num_t gpio, int level)
+{
+  if(gpio<0 || gpio>=HOST_GPIO_MAX || host_gpio_levels[gpio] == !!level) return;
+
+  host_gpio_levels[gpio]=!!level;
+  if(host_gpio_handlers[gpio] == NULL) return;
+  sim_task_in_isr=1;
+  host_gpio_handlers[gpio](host_gpio_args[gpio]);
+  sim_task_in_isr=0;
+}
@@ -0,0 +1,64 @@
+#include <stddef.h>
+
+#include "dib_clock.h"
+#include "led_backend_mock.h"
+
+//play fails by default, so that LED task times patterns itself
+t_led_mock led_mock={ .play_result=-1 };
+
+//helper, stores call
+static void led_mock_record(t_led_mock_op op, const t_led_output *out, int on)
+{
+  if(led_mock.count<LED_MOCK_CALLS_MAX)
+  {
+    t_led_mock_call *call=&led_mock.calls[led_mock.count];
+
+    call->op=op;
+    call->gpio=out->gpio;
+    call->on=on;
+    call->us=dib_clock_us();
+  }
+  led_mock.count++;
+}
+
+static int led_mock_init(t_led_output *out)
+{
+  led_mock_record(LED_MOCK_INIT, out, 0);
+  return led_mock.init_result;
+}
+
+static void led_mock_set(t_led_output *out, int on)
+{
+  led_mock_record(LED_MOCK_SET, out, !!on);
+}
+
+static int led_mock_play(t_led_output *out, const t_led_pattern *pattern)
+{
+  led_mock_record(LED_MOCK_PLAY, out, (int)pattern->count);
+  return led_mock.play_result;
+}
+
+static void led_mock_stop(t_led_output *out)
+{
+  led_mock_record(LED_MOCK_STOP, out, 0);
+}
+
+static void led_mock_deinit(t_led_output *out)
+{
+  led_mock_record(LED_MOCK_DEINIT, out, 0);
+}
+
+const t_led_backend led_backend_mock = {
+  .name = "mock",
+  .init = led_mock_init,
+  .set = led_mock_set,
+  .play = led_mock_play,
+  .stop = led_mock_stop,
+  .deinit = led_mock_deinit,
+};
+
+//forgets recorded calls, results are kept
+void led_mock_clear(void)
+{
+  led_mock.count=0;
+}
@@ -0,0 +1,53 @@
+#ifndef __LED_BACKEND_MOCK_H
+#define __LED_BACKEND_MOCK_H
+
+#include <stdint.h>
+
+#include "led_backend.h"
+
+//recording backend of host tests, every call is stored with simulated time
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LED_MOCK_CALLS_MAX
+#define LED_MOCK_CALLS_MAX 256
+#endif
+
+typedef enum _t_led_mock_op
+{
+  LED_MOCK_INIT = 0,
+  LED_MOCK_SET,
+  LED_MOCK_PLAY,
+  LED_MOCK_STOP,
+  LED_MOCK_DEINIT
+} t_led_mock_op;
+
+typedef struct _t_led_mock_call
+{
+  t_led_mock_op op;
+  unsigned int gpio;
+  int on; //set: requested state, play: number of pattern segments
+  int64_t us; //dib_clock_us() at call
+} t_led_mock_call;
+
+typedef struct _t_led_mock
+{
+  t_led_mock_call calls[LED_MOCK_CALLS_MAX];
+  int count; //number of recorded calls, calls over LED_MOCK_CALLS_MAX are counted but not stored
+  int init_result; //returned by init
+  int play_result; //returned by play, nonzero keeps patterns in software
+} t_led_mock;
+
+extern t_led_mock led_mock;
+extern const t_led_backend led_backend_mock;
+
+//forgets recorded calls, results are kept
+void led_mock_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+#include "dib_clock.h"
+#include "sim_clock.h"
+
+static int64_t sim_clock_now;
+
+//provides dib_clock_us of DIB_HOST build
+int64_t dib_clock_us(void)
+{
+  return sim_clock_now;
+}
+
+//sets clock to us
+void sim_clock_set(int64_t us)
+{
+  sim_clock_now=us;
+}
+
+//moves clock forward by us
+void sim_clock_advance(int64_t us)
+{
+  sim_clock_now+=us;
+}
@@ -0,0 +1,22 @@
+#ifndef __SIM_CLOCK_H
+#define __SIM_CLOCK_H
+
+#include <stdint.h>
+
+//simulated clock of host build, dib_clock_us() returns it and only tests move it, so runs are deterministic
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//sets clock to us
+void sim_clock_set(int64_t us);
+
+//moves clock forward by us
+void sim_clock_advance(int64_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
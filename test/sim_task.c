@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <ucontext.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include "dib_clock.h"
+#include "sim_clock.h"
+#include "sim_task.h"
+
+//switches in a row without clock moving that are taken as busy loop
+#define SIM_TASK_CYCLES_MAX 10000
+
+//simulated tasks and timers, tests create few of them
+#define SIM_TASKS_MAX 8
+#define SIM_TIMERS_MAX 8
+//host stack of simulated task, task stacks of the device are far smaller
+#define SIM_TASK_STACK (256 * 1024)
+
+int sim_task_in_isr;
+
+typedef struct _t_sim_task
+{
+  TaskFunction_t fn;
+  void *arg;
+  unsigned int prio;
+  ucontext_t ctx;
+  int notified; //pending notifications
+  int on_notify; //blocked in ulTaskNotifyTake, notification wakes it
+  int64_t wake; //planned wake up, INT64_MAX none
+} t_sim_task;
+
+struct esp_timer
+{
+  esp_timer_cb_t cb;
+  void *arg;
+  int64_t due; //INT64_MAX when stopped
+  int64_t period; //0 for one-shot
+};
+
+static t_sim_task sim_tasks[SIM_TASKS_MAX];
+static int sim_tasks_len;
+static t_sim_task *sim_task_current; //NULL when test code runs
+static ucontext_t sim_task_runner;
+
+static struct esp_timer sim_timers[SIM_TIMERS_MAX];
+static int sim_timers_len;
+
+//helper, runs task function on its own stack
+static void sim_task_entry(void)
+{
+  sim_task_current->fn(sim_task_current->arg);
+  //task returned, it never runs again
+  sim_task_current->wake=INT64_MAX;
+  sim_task_current->on_notify=0;
+}
+
+//tasks run cooperatively until they block, sim_task_run decides who runs next
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, unsigned int prio, TaskHandle_t *handle)
+{
+  t_sim_task *t;
+
+  if(sim_tasks_len>=SIM_TASKS_MAX) return !pdPASS;
+
+  t=&sim_tasks[sim_tasks_len];
+  if(getcontext(&t->ctx)) return !pdPASS;
+  t->ctx.uc_stack.ss_sp=malloc(SIM_TASK_STACK);
+  if(t->ctx.uc_stack.ss_sp == NULL) return !pdPASS;
+  t->ctx.uc_stack.ss_size=SIM_TASK_STACK;
+  t->ctx.uc_link=&sim_task_runner;
+  makecontext(&t->ctx, sim_task_entry, 0);
+
+  t->fn=fn;
+  t->arg=arg;
+  t->prio=prio;
+  t->notified=0;
+  t->on_notify=0;
+  t->wake=dib_clock_us();
+  sim_tasks_len++;
+
+  if(handle) *handle=(TaskHandle_t)t;
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return (TaskHandle_t)sim_task_current;
+}
+
+//helper, gives control back to sim_task_run, task is resumed at wake or by notification when on_notify is set
+static void sim_task_block(int64_t wake, int on_notify)
+{
+  t_sim_task *t=sim_task_current;
+
+  if(t == NULL)
+  {
+    fprintf(stderr, "sim_task: test code cannot block\n");
+    abort();
+  }
+  t->wake=wake;
+  t->on_notify=on_notify;
+  swapcontext(&t->ctx, &sim_task_runner);
+}
+
+//helper, converts ticks of timeout into wake up time
+static int64_t sim_task_after(TickType_t ticks)
+{
+  if(ticks == portMAX_DELAY) return INT64_MAX;
+  return dib_clock_us()+(int64_t)ticks*portTICK_PERIOD_MS*1000;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  sim_task_block(sim_task_after(ticks), 0);
+}
+
+void vTaskSuspend(TaskHandle_t task)
+{
+  sim_task_block(INT64_MAX, 0);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  ((t_sim_task *)task)->notified++;
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+  ((t_sim_task *)task)->notified++;
+  if(woken) *woken=pdTRUE;
+}
+
+//blocks until notified or wait passes, every call gives other due tasks a turn
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+  t_sim_task *t=sim_task_current;
+  uint32_t n;
+
+  sim_task_block(t->notified ? dib_clock_us() : sim_task_after(wait), 1);
+
+  n=t->notified;
+  if(n) t->notified=clear ? 0 : n-1;
+  return n;
+}
+
+//time passes for calling task only, other tasks and timers run meanwhile
+void sim_task_sleep(int64_t us)
+{
+  sim_task_block(dib_clock_us()+(us>0 ? us : 0), 0);
+}
+
+//helper, returns due task with highest priority (first created among equal ones), NULL when none is due
+static t_sim_task *sim_task_due(int64_t now)
+{
+  t_sim_task *best=NULL, *t;
+
+  for(int i=0;i<sim_tasks_len;i++)
+  {
+    t=&sim_tasks[i];
+    if(t->wake>now && !(t->on_notify && t->notified)) continue;
+    if(best == NULL || t->prio>best->prio) best=t;
+  }
+  return best;
+}
+
+//helper, returns due timer, NULL when none is due
+static struct esp_timer *sim_timer_due(int64_t now)
+{
+  struct esp_timer *best=NULL;
+
+  for(int i=0;i<sim_timers_len;i++)
+  {
+    if(sim_timers[i].due>now) continue;
+    if(best == NULL || sim_timers[i].due<best->due) best=&sim_timers[i];
+  }
+  return best;
+}
+
+//runs tasks and timers due until clock reaches until (us), clock is left at until
+int sim_task_run(int64_t until)
+{
+  t_sim_task *t;
+  struct esp_timer *timer;
+  int64_t next;
+  int cycles=0, busy=0;
+
+  for(;;)
+  {
+    if(++busy>SIM_TASK_CYCLES_MAX) return -1;
+
+    //timers first, esp_timer task has higher priority than bot tasks
+    timer=sim_timer_due(dib_clock_us());
+    if(timer)
+    {
+      timer->due=timer->period ? timer->due+timer->period : INT64_MAX;
+      timer->cb(timer->arg);
+      continue;
+    }
+
+    t=sim_task_due(dib_clock_us());
+    if(t)
+    {
+      sim_task_current=t;
+      swapcontext(&sim_task_runner, &t->ctx);
+      sim_task_current=NULL;
+      cycles++;
+      continue;
+    }
+
+    next=sim_task_wake();
+    if(next>until) break;
+    sim_clock_set(next);
+    busy=0;
+  }
+
+  if(dib_clock_us()<until) sim_clock_set(until);
+  return cycles;
+}
+
+//time of next planned wake up of task or timer in us
+int64_t sim_task_wake(void)
+{
+  int64_t next=INT64_MAX;
+
+  for(int i=0;i<sim_tasks_len;i++)
+  {
+    if(sim_tasks[i].on_notify && sim_tasks[i].notified) return dib_clock_us();
+    if(sim_tasks[i].wake<next) next=sim_tasks[i].wake;
+  }
+  for(int i=0;i<sim_timers_len;i++)
+  {
+    if(sim_timers[i].due<next) next=sim_timers[i].due;
+  }
+  return next;
+}
+
+//esp_timer of host build, callbacks are run by sim_task_run when due
+
+int64_t esp_timer_get_time(void)
+{
+  return dib_clock_us();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+  struct esp_timer *timer;
+
+  if(sim_timers_len>=SIM_TIMERS_MAX) return ESP_ERR_NO_MEM;
+
+  timer=&sim_timers[sim_timers_len++];
+  timer->cb=args->callback;
+  timer->arg=args->arg;
+  timer->due=INT64_MAX;
+  timer->period=0;
+  *handle=timer;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t us)
+{
+  if(timer->due!=INT64_MAX) return ESP_ERR_INVALID_STATE;
+  timer->due=dib_clock_us()+(int64_t)us;
+  timer->period=0;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t us)
+{
+  if(timer->due!=INT64_MAX) return ESP_ERR_INVALID_STATE;
+  timer->due=dib_clock_us()+(int64_t)us;
+  timer->period=(int64_t)us;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  if(timer->due == INT64_MAX) return ESP_ERR_INVALID_STATE;
+  timer->due=INT64_MAX;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+  return timer->due!=INT64_MAX;
+}
@@ -0,0 +1,31 @@
+#ifndef __SIM_TASK_H
+#define __SIM_TASK_H
+
+#include <stdint.h>
+
+//simulated FreeRTOS tasks of host build
+//every task created by xTaskCreate runs on its own stack until it blocks (ulTaskNotifyTake, vTaskDelay, sim_task_sleep),
+//sim_task_run then resumes the due one of highest priority, nothing is preempted, esp_timer callbacks run when due
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//nonzero makes xPortInIsrContext() report ISR context
+extern int sim_task_in_isr;
+
+//runs tasks and timers due until clock reaches until (us), clock is left at until
+//returns number of task resumptions, -1 when tasks keep waking up without clock moving
+int sim_task_run(int64_t until);
+
+//time of next planned wake up of task or timer in us, INT64_MAX when tasks wait for notification only
+int64_t sim_task_wake(void);
+
+//blocks calling task for us of simulated time, e.g. while a mocked request travels, notifications do not wake it
+void sim_task_sleep(int64_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
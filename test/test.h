@@ -0,0 +1,36 @@
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+
+//minimal checks of host tests, failures are counted and printed, test keeps going
+
+static int test_failed;
+
+#define TEST_CHECK(cond) do { \
+    if (!(cond)) \
+    { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      test_failed++; \
+    } \
+  } while (0)
+
+#define TEST_CHECK_EQ(a, b) do { \
+    long long test_a_ = (long long)(a), test_b_ = (long long)(b); \
+    if (test_a_ != test_b_) \
+    { \
+      fprintf(stderr, "%s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, test_a_, test_b_); \
+      test_failed++; \
+    } \
+  } while (0)
+
+#define TEST_RUN(fn) do { \
+    int test_before_ = test_failed; \
+    fn(); \
+    printf("%s %s\n", test_failed == test_before_ ? "ok  " : "FAIL", #fn); \
+  } while (0)
+
+//exit code of test executable
+#define TEST_RESULT() (test_failed ? 1 : 0)
+
+#endif
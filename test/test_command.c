@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "command.h"
+#include "test.h"
+
+//every command with its name, a new command has to be added here as well
+static const struct
+{
+  const char *name;
+  t_command command;
+} names[] = {
+  {"status", COMMAND_STATUS},
+  {"history", COMMAND_HISTORY},
+  {"stats", COMMAND_STATS},
+  {"mute", COMMAND_MUTE},
+  {"unmute", COMMAND_UNMUTE},
+  {"help", COMMAND_HELP},
+  {"latency", COMMAND_LATENCY},
+  {"subscribe", COMMAND_SUBSCRIBE},
+  {"unsubscribe", COMMAND_UNSUBSCRIBE},
+};
+
+#define NAMES_LEN ((int)(sizeof(names) / sizeof(names[0])))
+
+//list covers every command once
+static void test_list_complete(void)
+{
+  int seen[COMMAND_COUNT] = {0};
+
+  TEST_CHECK_EQ(NAMES_LEN, COMMAND_COUNT - 1);
+  for (int i = 0; i < NAMES_LEN; i++) seen[names[i].command]++;
+  for (int c = COMMAND_NONE + 1; c < COMMAND_COUNT; c++) TEST_CHECK_EQ(seen[c], 1);
+}
+
+//no two names share slot of hash table
+static void test_no_collisions(void)
+{
+  for (int i = 0; i < NAMES_LEN; i++)
+  {
+    for (int j = i + 1; j < NAMES_LEN; j++)
+    {
+      if (COMMAND_HASH(names[i].name, strlen(names[i].name)) == COMMAND_HASH(names[j].name, strlen(names[j].name)))
+      {
+        TEST_CHECK(!"names share slot");
+        fprintf(stderr, "  %s and %s\n", names[i].name, names[j].name);
+      }
+    }
+  }
+}
+
+//every name parses to its command, with or without arguments
+static void test_names(void)
+{
+  char text[64];
+  const char *args;
+
+  for (int i = 0; i < NAMES_LEN; i++)
+  {
+    snprintf(text, sizeof(text), "!%s", names[i].name);
+    args = NULL;
+    TEST_CHECK_EQ(command_parse(text, &args), names[i].command);
+    TEST_CHECK(args && *args == 0);
+
+    snprintf(text, sizeof(text), "!%s   Door 2", names[i].name);
+    TEST_CHECK_EQ(command_parse(text, &args), names[i].command);
+    TEST_CHECK(args && strcmp(args, "Door 2") == 0);
+
+    snprintf(text, sizeof(text), "!%s\nnext line", names[i].name);
+    TEST_CHECK_EQ(command_parse(text, NULL), names[i].command);
+  }
+}
+
+//prefixes, longer names, unknown names and wrong case are not commands
+static void test_rejected(void)
+{
+  static const char *texts[] = {
+    NULL, "", "!", "! status", "status", "?status", "!stat", "!statu", "!statuses", "!mut", "!muted",
+    "!subscribed", "!unsubscribeme", "!unsubscribed", "!h", "!hel", "!helpme", "!hello", "!nope",
+    "!Status", "!STATUS", "!Mute", "!HELP", "!unSubscribe", "!LATENCY",
+  };
+  char text[64];
+
+  for (unsigned int i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+  {
+    if (command_parse(texts[i], NULL) != COMMAND_NONE)
+    {
+      TEST_CHECK(!"text parsed as command");
+      fprintf(stderr, "  \"%s\"\n", texts[i]);
+    }
+  }
+
+  //every proper prefix of every name
+  for (int i = 0; i < NAMES_LEN; i++)
+  {
+    for (size_t len = 1; len < strlen(names[i].name); len++)
+    {
+      snprintf(text, sizeof(text), "!%.*s", (int)len, names[i].name);
+      TEST_CHECK_EQ(command_parse(text, NULL), COMMAND_NONE);
+    }
+  }
+}
+
+int main(void)
+{
+  TEST_RUN(test_list_complete);
+  TEST_RUN(test_no_collisions);
+  TEST_RUN(test_names);
+  TEST_RUN(test_rejected);
+  return TEST_RESULT();
+}
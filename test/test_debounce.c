@@ -0,0 +1,125 @@
+#include "debounce.h"
+#include "test.h"
+
+#define WINDOW 20000 //20 ms
+
+//clean edge is confirmed once it has been stable for window, event carries time of edge
+static void test_clean_edge(void)
+{
+  t_debounce d;
+  t_debounce_event ev;
+
+  debounce_init(&d, 0, WINDOW);
+  TEST_CHECK_EQ(debounce_deadline(&d), -1);
+
+  TEST_CHECK_EQ(debounce_edge(&d, 1, 1000, &ev), 0);
+  TEST_CHECK_EQ(debounce_deadline(&d), 1000 + WINDOW);
+  TEST_CHECK_EQ(debounce_poll(&d, 1000 + WINDOW - 1, &ev), 0);
+  TEST_CHECK_EQ(debounce_poll(&d, 1000 + WINDOW, &ev), 1);
+  TEST_CHECK_EQ(ev.level, 1);
+  TEST_CHECK_EQ(ev.time, 1000);
+  TEST_CHECK_EQ(debounce_deadline(&d), -1);
+  //confirmed once only
+  TEST_CHECK_EQ(debounce_poll(&d, 1000 + 5 * WINDOW, &ev), 0);
+}
+
+//bounce train that ends at old level is no change at all
+static void test_bounce_back(void)
+{
+  t_debounce d;
+  t_debounce_event ev;
+  int64_t t = 1000;
+
+  debounce_init(&d, 0, WINDOW);
+  for (int i = 0; i < 10; i++)
+  {
+    TEST_CHECK_EQ(debounce_edge(&d, 1, t, &ev), 0);
+    t += 1000;
+    TEST_CHECK_EQ(debounce_edge(&d, 0, t, &ev), 0);
+    t += 1000;
+  }
+  TEST_CHECK_EQ(debounce_deadline(&d), -1);
+  TEST_CHECK_EQ(debounce_poll(&d, t + 10 * WINDOW, &ev), 0);
+  TEST_CHECK_EQ(d.stable, 0);
+}
+
+//bounce train that ends at new level is one change, counted from last edge to that level
+static void test_bounce_train(void)
+{
+  t_debounce d;
+  t_debounce_event ev;
+  int64_t t = 1000, last = 0;
+
+  debounce_init(&d, 0, WINDOW);
+  for (int i = 0; i < 5; i++)
+  {
+    last = t;
+    TEST_CHECK_EQ(debounce_edge(&d, 1, t, &ev), 0);
+    t += 2000;
+    if (i < 4) TEST_CHECK_EQ(debounce_edge(&d, 0, t, &ev), 0);
+    t += 2000;
+  }
+  TEST_CHECK_EQ(debounce_deadline(&d), last + WINDOW);
+  TEST_CHECK_EQ(debounce_poll(&d, last + WINDOW - 1, &ev), 0);
+  TEST_CHECK_EQ(debounce_poll(&d, last + WINDOW, &ev), 1);
+  TEST_CHECK_EQ(ev.level, 1);
+  TEST_CHECK_EQ(ev.time, last);
+}
+
+//edge coming late confirms candidate that has been stable long enough before it, nothing is lost without poll
+static void test_edge_confirms_previous(void)
+{
+  t_debounce d;
+  t_debounce_event ev;
+
+  debounce_init(&d, 0, WINDOW);
+  TEST_CHECK_EQ(debounce_edge(&d, 1, 1000, &ev), 0);
+  TEST_CHECK_EQ(debounce_edge(&d, 0, 1000 + 3 * WINDOW, &ev), 1);
+  TEST_CHECK_EQ(ev.level, 1);
+  TEST_CHECK_EQ(ev.time, 1000);
+  //closing is the next candidate
+  TEST_CHECK_EQ(debounce_deadline(&d), 1000 + 4 * WINDOW);
+  TEST_CHECK_EQ(debounce_poll(&d, 1000 + 4 * WINDOW, &ev), 1);
+  TEST_CHECK_EQ(ev.level, 0);
+}
+
+//repeated edge to the same level (missed opposite edge) does not restart window
+static void test_repeated_level(void)
+{
+  t_debounce d;
+  t_debounce_event ev;
+
+  debounce_init(&d, 0, WINDOW);
+  debounce_edge(&d, 1, 1000, &ev);
+  debounce_edge(&d, 1, 1000 + WINDOW / 2, &ev);
+  TEST_CHECK_EQ(debounce_deadline(&d), 1000 + WINDOW);
+  TEST_CHECK_EQ(debounce_poll(&d, 1000 + WINDOW, &ev), 1);
+  TEST_CHECK_EQ(ev.time, 1000);
+}
+
+//poll with time taken before edge that broke candidate must not confirm it
+static void test_poll_before_edge(void)
+{
+  t_debounce d;
+  t_debounce_event ev;
+  int64_t now;
+
+  debounce_init(&d, 0, WINDOW);
+  debounce_edge(&d, 1, 1000, &ev);
+  //relay task reads time, then bounce arrives just before window ends
+  now = 1000 + WINDOW - 10;
+  debounce_edge(&d, 0, 1000 + WINDOW - 5, &ev);
+  TEST_CHECK_EQ(debounce_poll(&d, now, &ev), 0);
+  TEST_CHECK_EQ(d.stable, 0);
+}
+
+int main(void)
+{
+  TEST_RUN(test_clean_edge);
+  TEST_RUN(test_bounce_back);
+  TEST_RUN(test_bounce_train);
+  TEST_RUN(test_edge_confirms_previous);
+  TEST_RUN(test_repeated_level);
+  TEST_RUN(test_poll_before_edge);
+  return TEST_RESULT();
+}
@@ -0,0 +1,53 @@
+#include <string.h>
+
+#include "latency.h"
+#include "test.h"
+
+#define MS 1000LL
+
+//p50 and p99 are reported as bucket bounds, max exactly
+static void test_percentiles(void)
+{
+  char buf[512];
+
+  latency_reset();
+  //98 fast, 2 slow: p99 falls into the slow bucket
+  for (int i = 0; i < 98; i++) latency_record(LATENCY_REQUEST, 3 * MS);
+  latency_record(LATENCY_REQUEST, 30 * MS);
+  latency_record(LATENCY_REQUEST, 42 * MS);
+  latency_record(LATENCY_REQUEST, -1); //ignored
+
+  latency_render(buf, sizeof(buf));
+  TEST_CHECK(strstr(buf, "request n=100 p50<5ms p99<50ms max=42ms") != NULL);
+  TEST_CHECK(strstr(buf, "debounce n=0") != NULL);
+
+  //slowest beyond the last bound
+  latency_record(LATENCY_HTTP, 12000 * MS);
+  latency_render(buf, sizeof(buf));
+  TEST_CHECK(strstr(buf, "http n=1 p50>=10000ms p99>=10000ms max=12000ms") != NULL);
+
+  latency_reset();
+  latency_render(buf, sizeof(buf));
+  TEST_CHECK(strstr(buf, "request n=0") != NULL);
+}
+
+//histogram has one line per nonempty bucket
+static void test_histogram(void)
+{
+  char buf[512];
+
+  latency_reset();
+  TEST_CHECK_EQ(latency_render_histogram(LATENCY_QUEUE, buf, sizeof(buf)), 0);
+  latency_record(LATENCY_QUEUE, 500);
+  latency_record(LATENCY_QUEUE, 150 * MS);
+  TEST_CHECK(latency_render_histogram(LATENCY_QUEUE, buf, sizeof(buf)) > 0);
+  TEST_CHECK(strchr(buf, '\n') != NULL);
+  TEST_CHECK(strchr(strchr(buf, '\n') + 1, '\n') == NULL);
+}
+
+int main(void)
+{
+  TEST_RUN(test_percentiles);
+  TEST_RUN(test_histogram);
+  return TEST_RESULT();
+}
@@ -0,0 +1,87 @@
+#include <stddef.h>
+
+#include "led_pattern.h"
+#include "test.h"
+
+//helper, plays pattern to its end, returns total time in ms, -1 when it runs longer than limit segments
+static int play(const t_led_pattern *p, int repeats, int limit, int *segments)
+{
+  t_led_cursor c;
+  const t_led_segment *s;
+  int total = 0, n = 0;
+
+  led_pattern_start(&c, repeats);
+  while ((s = led_pattern_next(p, &c)) != NULL)
+  {
+    if (++n > limit) return -1;
+    total += s->duration;
+  }
+  if (segments) *segments = n;
+  return total;
+}
+
+//every action has pattern, anything else has none
+static void test_tables(void)
+{
+  for (int a = 0; a < LED_ACTION_COUNT; a++)
+  {
+    const t_led_pattern *p = led_pattern_get((t_led_action)a);
+    TEST_CHECK(p != NULL);
+    if (p) TEST_CHECK(p->count > 0);
+  }
+  TEST_CHECK(led_pattern_get(LED_ACTION_COUNT) == NULL);
+  TEST_CHECK(led_pattern_get((t_led_action)-1) == NULL);
+
+  TEST_CHECK(led_pattern_is_static(led_pattern_get(LED_OFF)));
+  TEST_CHECK(led_pattern_is_static(led_pattern_get(LED_ON)));
+  TEST_CHECK(!led_pattern_is_static(led_pattern_get(LED_BLINKING_SLOWLY)));
+  TEST_CHECK(!led_pattern_is_static(led_pattern_get(LED_SOS)));
+}
+
+//one blink is on, off and end
+static void test_blink_once(void)
+{
+  const t_led_pattern *p = led_pattern_get(LED_BLINK_ONCE);
+  t_led_cursor c;
+  const t_led_segment *s;
+
+  led_pattern_start(&c, 0);
+  s = led_pattern_next(p, &c);
+  TEST_CHECK(s && s->on && s->duration == 100);
+  s = led_pattern_next(p, &c);
+  TEST_CHECK(s && !s->on && s->duration == 400);
+  TEST_CHECK(led_pattern_next(p, &c) == NULL);
+}
+
+//pattern is played once and then repeated repeats times
+static void test_repeats(void)
+{
+  int n = 0;
+
+  TEST_CHECK_EQ(play(led_pattern_get(LED_BLINK_ONCE), 2, 100, &n), 3 * 500);
+  TEST_CHECK_EQ(n, 6);
+  //same period as slow blink
+  TEST_CHECK_EQ(play(led_pattern_get(LED_DOUBLE_BLINK), 0, 100, &n), 2000);
+  TEST_CHECK_EQ(n, 4);
+  //forever never ends
+  TEST_CHECK_EQ(play(led_pattern_get(LED_BLINKING_ANGRY), -1, 1000, NULL), -1);
+}
+
+//SOS follows morse timing, dot 150 ms
+static void test_sos_timing(void)
+{
+  int n = 0;
+
+  //9 symbols: 6 dots and 3 dashes, 6 gaps inside letters, 2 between letters, 1 after word
+  TEST_CHECK_EQ(play(led_pattern_get(LED_SOS), 0, 100, &n), 6 * 150 + 3 * 450 + 6 * 150 + 2 * 450 + 1050);
+  TEST_CHECK_EQ(n, 18);
+}
+
+int main(void)
+{
+  TEST_RUN(test_tables);
+  TEST_RUN(test_blink_once);
+  TEST_RUN(test_repeats);
+  TEST_RUN(test_sos_timing);
+  return TEST_RESULT();
+}
@@ -0,0 +1,315 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "led_task.h"
+#include "led_pattern.h"
+#include "led_backend_mock.h"
+#include "sim_clock.h"
+#include "sim_task.h"
+#include "dib_clock.h"
+#include "test.h"
+
+//led task runs on simulated clock and scheduler, every backend call is recorded by led_backend_mock
+
+#define MS 1000LL
+
+//helper, collects set calls of gpio recorded from index from, returns their number
+static int sets_of(unsigned int gpio, int from, t_led_mock_call *out, int max)
+{
+  int n = 0;
+
+  for (int i = from; i < led_mock.count && i < LED_MOCK_CALLS_MAX; i++)
+  {
+    if (led_mock.calls[i].op != LED_MOCK_SET || led_mock.calls[i].gpio != gpio) continue;
+    if (n < max) out[n] = led_mock.calls[i];
+    n++;
+  }
+  return n;
+}
+
+//helper, counts calls op of gpio
+static int calls_of(t_led_mock_op op, unsigned int gpio)
+{
+  int n = 0;
+
+  for (int i = 0; i < led_mock.count && i < LED_MOCK_CALLS_MAX; i++)
+  {
+    if (led_mock.calls[i].op == op && led_mock.calls[i].gpio == gpio) n++;
+  }
+  return n;
+}
+
+//helper, creates output and lets led task register it, recorded calls start empty
+static void *output(unsigned int gpio)
+{
+  void *h = led_init(gpio, 1);
+
+  TEST_CHECK(h != NULL);
+  sim_task_run(dib_clock_us());
+  led_mock_clear();
+  return h;
+}
+
+//helper, releases output and lets led task free it
+static void release(void *h)
+{
+  led_deinit(h);
+  sim_task_run(dib_clock_us());
+}
+
+//new output is initialized by backend and stays dark until first action
+static void test_init(void)
+{
+  void *h;
+
+  sim_clock_set(1000 * MS);
+  led_mock_clear();
+  h = led_init(2, 1);
+  TEST_CHECK(h != NULL);
+  TEST_CHECK_EQ(calls_of(LED_MOCK_INIT, 2), 1);
+
+  TEST_CHECK(sim_task_run(dib_clock_us()) > 0);
+  TEST_CHECK_EQ(calls_of(LED_MOCK_SET, 2), 0);
+  TEST_CHECK_EQ(sim_task_wake(), INT64_MAX);
+
+  release(h);
+  TEST_CHECK_EQ(calls_of(LED_MOCK_DEINIT, 2), 1);
+}
+
+//one blink is on, off after 100 ms and dark again when action ends
+static void test_blink_once(void)
+{
+  t_led_mock_call s[8];
+  void *h = output(3);
+  int64_t t0 = dib_clock_us();
+
+  led_push_action(h, LED_BLINK_ONCE, 0);
+  sim_task_run(t0 + 2000 * MS);
+
+  TEST_CHECK_EQ(sets_of(3, 0, s, 8), 3);
+  TEST_CHECK(s[0].on && s[0].us == t0);
+  TEST_CHECK(!s[1].on && s[1].us == t0 + 100 * MS);
+  TEST_CHECK(!s[2].on && s[2].us == t0 + 500 * MS);
+  TEST_CHECK_EQ(sim_task_wake(), INT64_MAX);
+
+  release(h);
+}
+
+//every segment of pattern is shown at the time pattern says
+static void test_follows_pattern(void)
+{
+  const t_led_pattern *p = led_pattern_get(LED_SOS);
+  const t_led_segment *seg;
+  t_led_cursor c;
+  t_led_mock_call s[64];
+  void *h = output(4);
+  int64_t t0 = dib_clock_us(), t = t0;
+  int n, i = 0;
+
+  led_push_action(h, LED_SOS, 1);
+  sim_task_run(t0 + 20000 * MS);
+  n = sets_of(4, 0, s, 64);
+
+  led_pattern_start(&c, 1);
+  while ((seg = led_pattern_next(p, &c)) != NULL)
+  {
+    TEST_CHECK(i < n);
+    if (i >= n) break;
+    TEST_CHECK_EQ(s[i].on, seg->on);
+    TEST_CHECK_EQ(s[i].us, t);
+    t += seg->duration * MS;
+    i++;
+  }
+  //dark at the end
+  TEST_CHECK_EQ(n, i + 1);
+  TEST_CHECK(!s[i].on && s[i].us == t);
+
+  release(h);
+}
+
+//open ended action is replaced by the next one right away
+static void test_open_ended_replaced(void)
+{
+  t_led_mock_call s[8];
+  void *h = output(5);
+  int64_t t0 = dib_clock_us();
+
+  led_push_action(h, LED_BLINKING_SLOWLY, -1);
+  sim_task_run(t0 + 1000 * MS);
+  led_push_action(h, LED_ON, -1);
+  sim_task_run(t0 + 5000 * MS);
+
+  //slow blink: on, off after 100 ms, then on is pushed in the middle of off time
+  TEST_CHECK_EQ(sets_of(5, 0, s, 8), 3);
+  TEST_CHECK(s[0].on && s[0].us == t0);
+  TEST_CHECK(!s[1].on && s[1].us == t0 + 100 * MS);
+  TEST_CHECK(s[2].on && s[2].us == t0 + 1000 * MS);
+  TEST_CHECK_EQ(sim_task_wake(), INT64_MAX);
+
+  //pushed together, only the last one is shown
+  led_mock_clear();
+  led_push_action(h, LED_BLINKING_ANGRY, -1);
+  led_push_action(h, LED_OFF, -1);
+  sim_task_run(t0 + 6000 * MS);
+  TEST_CHECK_EQ(sets_of(5, 0, s, 8), 1);
+  TEST_CHECK(!s[0].on && s[0].us == t0 + 5000 * MS);
+
+  release(h);
+}
+
+//finite action finishes before the next one starts
+static void test_finite_finishes(void)
+{
+  t_led_mock_call s[8];
+  void *h = output(6);
+  int64_t t0 = dib_clock_us();
+
+  led_push_action(h, LED_BLINK_ONCE, 0);
+  led_push_action(h, LED_ON, -1);
+  sim_task_run(t0 + 2000 * MS);
+
+  TEST_CHECK_EQ(sets_of(6, 0, s, 8), 3);
+  TEST_CHECK(s[0].on && s[0].us == t0);
+  TEST_CHECK(!s[1].on && s[1].us == t0 + 100 * MS);
+  TEST_CHECK(s[2].on && s[2].us == t0 + 500 * MS);
+
+  release(h);
+}
+
+//outputs are timed independently by one task
+static void test_two_outputs(void)
+{
+  t_led_mock_call a[64], b[8];
+  void *ha = output(7), *hb = output(8);
+  int64_t t0 = dib_clock_us();
+  int n;
+
+  led_push_action(ha, LED_BLINKING_ANGRY, -1);
+  led_push_action(hb, LED_BLINKING_SLOWLY, -1);
+  sim_task_run(t0 + 4000 * MS);
+
+  n = sets_of(7, 0, a, 64);
+  TEST_CHECK_EQ(n, 41);
+  for (int i = 0; i < n && i < 64; i++)
+  {
+    TEST_CHECK_EQ(a[i].on, !(i & 1));
+    TEST_CHECK_EQ(a[i].us, t0 + i * 100 * MS);
+  }
+
+  TEST_CHECK_EQ(sets_of(8, 0, b, 8), 5);
+  TEST_CHECK(b[0].on && b[0].us == t0);
+  TEST_CHECK(!b[1].on && b[1].us == t0 + 100 * MS);
+  TEST_CHECK(b[2].on && b[2].us == t0 + 2000 * MS);
+  TEST_CHECK(!b[3].on && b[3].us == t0 + 2100 * MS);
+  TEST_CHECK(b[4].on && b[4].us == t0 + 4000 * MS);
+
+  release(ha);
+  release(hb);
+}
+
+//endless pattern taken by hardware needs no wake ups, it is stopped by next action
+static void test_offload(void)
+{
+  t_led_mock_call s[8];
+  void *h = output(9);
+  int64_t t0 = dib_clock_us();
+
+  led_mock.play_result = 0;
+  led_push_action(h, LED_BLINKING_ANGRY, -1);
+  sim_task_run(t0 + 1000 * MS);
+  TEST_CHECK_EQ(calls_of(LED_MOCK_PLAY, 9), 1);
+  TEST_CHECK_EQ(sets_of(9, 0, s, 8), 0);
+  TEST_CHECK_EQ(sim_task_wake(), INT64_MAX);
+
+  led_push_action(h, LED_OFF, -1);
+  sim_task_run(t0 + 2000 * MS);
+  TEST_CHECK_EQ(calls_of(LED_MOCK_STOP, 9), 1);
+  TEST_CHECK_EQ(sets_of(9, 0, s, 8), 1);
+  TEST_CHECK(!s[0].on && s[0].us == t0 + 1000 * MS);
+
+  //finite patterns stay in software
+  led_push_action(h, LED_BLINK_ONCE, 2);
+  sim_task_run(t0 + 5000 * MS);
+  TEST_CHECK_EQ(calls_of(LED_MOCK_PLAY, 9), 1);
+  led_mock.play_result = -1;
+
+  release(h);
+}
+
+//push from ISR wakes task as well
+static void test_push_from_isr(void)
+{
+  t_led_mock_call s[8];
+  void *h = output(10);
+  int64_t t0 = dib_clock_us();
+
+  sim_task_in_isr = 1;
+  led_push_action(h, LED_ON, -1);
+  sim_task_in_isr = 0;
+  sim_task_run(t0);
+  TEST_CHECK_EQ(sets_of(10, 0, s, 8), 1);
+  TEST_CHECK(s[0].on && s[0].us == t0);
+
+  release(h);
+}
+
+//actions over ring size are dropped until task takes them over
+static void test_ring_overflow(void)
+{
+  t_led_mock_call s[64];
+  void *h = output(11);
+  int64_t t0 = dib_clock_us();
+  int on = 0, n;
+
+  for (int i = 0; i < 11; i++) led_push_action(h, LED_BLINK_ONCE, 0);
+  sim_task_run(t0 + 10000 * MS);
+
+  n = sets_of(11, 0, s, 64);
+  for (int i = 0; i < n && i < 64; i++) on += s[i].on;
+  TEST_CHECK_EQ(on, 8);
+
+  release(h);
+}
+
+//released outputs are freed, so that their slots can be used again
+static void test_outputs_limit(void)
+{
+  void *h[9];
+
+  for (int round = 0; round < 2; round++)
+  {
+    led_mock_clear();
+    for (int i = 0; i < 8; i++)
+    {
+      h[i] = led_init(20 + i, 0);
+      TEST_CHECK(h[i] != NULL);
+    }
+    h[8] = led_init(28, 0);
+    TEST_CHECK(h[8] == NULL);
+    sim_task_run(dib_clock_us());
+
+    for (int i = 0; i < 8; i++)
+    {
+      led_push_action(h[i], LED_BLINKING_ANGRY, -1);
+      led_deinit(h[i]);
+      led_deinit(h[i]);
+    }
+    sim_task_run(dib_clock_us() + 1000 * MS);
+    for (int i = 0; i < 8; i++) TEST_CHECK_EQ(calls_of(LED_MOCK_DEINIT, 20 + i), 1);
+  }
+}
+
+int main(void)
+{
+  TEST_RUN(test_init);
+  TEST_RUN(test_blink_once);
+  TEST_RUN(test_follows_pattern);
+  TEST_RUN(test_open_ended_replaced);
+  TEST_RUN(test_finite_finishes);
+  TEST_RUN(test_two_outputs);
+  TEST_RUN(test_offload);
+  TEST_RUN(test_push_from_isr);
+  TEST_RUN(test_ring_overflow);
+  TEST_RUN(test_outputs_limit);
+  return TEST_RESULT();
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+
+#include "rate_limit.h"
+#include "test.h"
+
+#define S 1000000LL
+
+//unknown route gets Discord default of 5 messages per 5 s, window starts with first request
+static void test_default_bucket(void)
+{
+  t_rate_limit *rl = rate_limit_route("default", 1 * S);
+  int64_t now = 1 * S;
+
+  for (int i = 0; i < 5; i++)
+  {
+    TEST_CHECK_EQ(rate_limit_wait(rl, now), 0);
+    TEST_CHECK_EQ(rate_limit_low(rl, now), i >= 4);
+    rate_limit_consume(rl, now);
+    now += S / 10;
+  }
+  TEST_CHECK_EQ(rate_limit_wait(rl, now), 6 * S - now);
+  TEST_CHECK_EQ(rate_limit_wait(rl, 6 * S), 0);
+  TEST_CHECK(!rate_limit_low(rl, 6 * S));
+}
+
+//429 blocks route for Retry-After even when headers still leave tokens
+static void test_retry_after(void)
+{
+  t_rate_limit *rl = rate_limit_route("429", 10 * S);
+  int64_t now = 10 * S;
+
+  TEST_CHECK_EQ(rate_limit_wait(rl, now), 0);
+  rate_limit_consume(rl, now);
+  //sender applies headers first, then Retry-After of 429
+  rate_limit_update(rl, now, 5, 3, 2 * S);
+  rate_limit_block(rl, now, 1500000);
+  TEST_CHECK_EQ(rate_limit_wait(rl, now), 1500000);
+  TEST_CHECK_EQ(rate_limit_wait(rl, now + S), 500000);
+
+  //shorter block does not shorten the one in force
+  rate_limit_block(rl, now + S, 100000);
+  TEST_CHECK_EQ(rate_limit_wait(rl, now + S), 500000);
+
+  TEST_CHECK_EQ(rate_limit_wait(rl, now + 1500000), 0);
+  TEST_CHECK(!rate_limit_low(rl, now + 1500000));
+
+  //Retry-After longer than bucket reset still holds
+  rate_limit_block(rl, now + 2 * S, 3 * S);
+  TEST_CHECK_EQ(rate_limit_wait(rl, now + 4 * S), S);
+  TEST_CHECK_EQ(rate_limit_wait(rl, now + 5 * S), 0);
+}
+
+//remaining 0 waits for Reset-After, then bucket has full server limit
+static void test_remaining_zero(void)
+{
+  t_rate_limit *rl = rate_limit_route("empty", 20 * S);
+  int64_t now = 20 * S;
+
+  rate_limit_consume(rl, now);
+  rate_limit_update(rl, now, 10, 0, 800000);
+  TEST_CHECK(rate_limit_low(rl, now));
+  TEST_CHECK_EQ(rate_limit_wait(rl, now), 800000);
+  TEST_CHECK_EQ(rate_limit_wait(rl, now + 300000), 500000);
+
+  now += 800000;
+  TEST_CHECK(!rate_limit_low(rl, now));
+  for (int i = 0; i < 10; i++)
+  {
+    TEST_CHECK_EQ(rate_limit_wait(rl, now), 0);
+    rate_limit_consume(rl, now);
+  }
+  //own window is used when server tells nothing
+  TEST_CHECK_EQ(rate_limit_wait(rl, now), 5 * S);
+
+  //unknown values keep what is known
+  rate_limit_update(rl, now, -1, -1, -1);
+  TEST_CHECK_EQ(rl->limit, 10);
+  TEST_CHECK_EQ(rl->remaining, 0);
+  TEST_CHECK_EQ(rate_limit_wait(rl, now), 5 * S);
+}
+
+//table keeps RATE_LIMIT_ROUTES_MAX routes, least recently used one is evicted and forgotten
+static void test_lru_eviction(void)
+{
+  t_rate_limit *rl[RATE_LIMIT_ROUTES_MAX], *n;
+  char name[RATE_LIMIT_ROUTE_MAX];
+  int64_t now = 100 * S;
+
+  for (int i = 0; i < RATE_LIMIT_ROUTES_MAX; i++)
+  {
+    snprintf(name, sizeof(name), "r%d", i);
+    rl[i] = rate_limit_route(name, now++);
+    for (int j = 0; j < i; j++) TEST_CHECK(rl[i] != rl[j]);
+  }
+  rate_limit_block(rl[0], now, 60 * S);
+  rate_limit_update(rl[1], now, 50, 0, 60 * S);
+
+  //r0 is used again, so r1 is the oldest
+  TEST_CHECK(rate_limit_route("r0", now++) == rl[0]);
+  n = rate_limit_route("new", now++);
+  TEST_CHECK(n == rl[1]);
+  TEST_CHECK_EQ(rate_limit_wait(n, now), 0);
+  TEST_CHECK_EQ(n->limit, 5);
+
+  //r0 has kept its block, evicted r1 comes back with default bucket in place of r2
+  TEST_CHECK(rate_limit_route("r0", now) == rl[0]);
+  TEST_CHECK_EQ(rate_limit_wait(rl[0], now), 60 * S - 2);
+  n = rate_limit_route("r1", now++);
+  TEST_CHECK(n == rl[2]);
+  TEST_CHECK_EQ(rate_limit_wait(n, now), 0);
+  TEST_CHECK_EQ(n->remaining, 5);
+}
+
+int main(void)
+{
+  TEST_RUN(test_default_bucket);
+  TEST_RUN(test_retry_after);
+  TEST_RUN(test_remaining_zero);
+  TEST_RUN(test_lru_eviction);
+  return TEST_RESULT();
+}
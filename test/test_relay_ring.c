@@ -0,0 +1,87 @@
+#include <limits.h>
+#include <string.h>
+
+#include "relay_ring.h"
+#include "sim_clock.h"
+#include "dib_clock.h"
+#include "test.h"
+
+//edges come out in order they went in
+static void test_fifo(void)
+{
+  t_relay_ring ring;
+  t_relay_edge e = {0};
+
+  memset(&ring, 0, sizeof(ring));
+  sim_clock_set(1000);
+  for (int i = 0; i < 10; i++)
+  {
+    TEST_CHECK(relay_ring_push(&ring, i % 3, dib_clock_us(), i & 1));
+    sim_clock_advance(10);
+  }
+  for (int i = 0; i < 10; i++)
+  {
+    TEST_CHECK(relay_ring_pop(&ring, &e));
+    TEST_CHECK_EQ(e.sensor, i % 3);
+    TEST_CHECK_EQ(e.level, i & 1);
+    TEST_CHECK_EQ(e.time, 1000 + 10 * i);
+  }
+  TEST_CHECK(!relay_ring_pop(&ring, &e));
+  TEST_CHECK(!relay_ring_overflowed(&ring));
+}
+
+//full ring loses new edges, keeps old ones and reports overflow once
+static void test_overflow(void)
+{
+  t_relay_ring ring;
+  t_relay_edge e = {0};
+  int n = 0;
+
+  memset(&ring, 0, sizeof(ring));
+  for (int i = 0; i < RELAY_EDGES_MAX; i++) TEST_CHECK(relay_ring_push(&ring, 0, i, 1));
+  TEST_CHECK(!relay_ring_push(&ring, 0, RELAY_EDGES_MAX, 0));
+  TEST_CHECK(!relay_ring_push(&ring, 0, RELAY_EDGES_MAX + 1, 0));
+  TEST_CHECK(relay_ring_overflowed(&ring));
+  TEST_CHECK(!relay_ring_overflowed(&ring));
+
+  while (relay_ring_pop(&ring, &e))
+  {
+    TEST_CHECK_EQ(e.time, n);
+    n++;
+  }
+  TEST_CHECK_EQ(n, RELAY_EDGES_MAX);
+
+  //space is back
+  TEST_CHECK(relay_ring_push(&ring, 0, 0, 1));
+}
+
+//positions are free running counters, they wrap around unsigned range
+static void test_wrap(void)
+{
+  t_relay_ring ring;
+  t_relay_edge e = {0};
+
+  memset(&ring, 0, sizeof(ring));
+  atomic_store(&ring.head, UINT_MAX - 5);
+  atomic_store(&ring.tail, UINT_MAX - 5);
+  for (int round = 0; round < 3; round++)
+  {
+    for (int i = 0; i < RELAY_EDGES_MAX; i++) TEST_CHECK(relay_ring_push(&ring, 1, round * 1000 + i, 0));
+    TEST_CHECK(!relay_ring_push(&ring, 1, 0, 0));
+    for (int i = 0; i < RELAY_EDGES_MAX; i++)
+    {
+      TEST_CHECK(relay_ring_pop(&ring, &e));
+      TEST_CHECK_EQ(e.time, round * 1000 + i);
+    }
+    TEST_CHECK(!relay_ring_pop(&ring, &e));
+  }
+  TEST_CHECK(relay_ring_overflowed(&ring));
+}
+
+int main(void)
+{
+  TEST_RUN(test_fifo);
+  TEST_RUN(test_overflow);
+  TEST_RUN(test_wrap);
+  return TEST_RESULT();
+}
@@ -0,0 +1,250 @@
+#include <string.h>
+
+#include "wifi_conn.h"
+#include "test.h"
+
+#define S 1000000LL
+
+//fake driver, records calls in order
+#define FAKE_CALLS_MAX 64
+
+typedef enum _t_fake_op
+{
+  FAKE_CONNECT = 0,
+  FAKE_REPROVISION,
+  FAKE_CHANGED
+} t_fake_op;
+
+typedef struct _t_fake_call
+{
+  t_fake_op op;
+  t_wifi_conn_state state; //FAKE_CHANGED only
+} t_fake_call;
+
+typedef struct _t_fake
+{
+  t_fake_call calls[FAKE_CALLS_MAX];
+  int count;
+} t_fake;
+
+static void fake_record(t_fake *f, t_fake_op op, t_wifi_conn_state state)
+{
+  if (f->count < FAKE_CALLS_MAX)
+  {
+    f->calls[f->count].op = op;
+    f->calls[f->count].state = state;
+  }
+  f->count++;
+}
+
+static void fake_connect(void *ctx)
+{
+  fake_record((t_fake *)ctx, FAKE_CONNECT, WIFI_CONN_IDLE);
+}
+
+static void fake_reprovision(void *ctx)
+{
+  fake_record((t_fake *)ctx, FAKE_REPROVISION, WIFI_CONN_IDLE);
+}
+
+static void fake_changed(void *ctx, t_wifi_conn_state state)
+{
+  fake_record((t_fake *)ctx, FAKE_CHANGED, state);
+}
+
+static const t_wifi_conn_driver fake_driver = {
+  .connect = fake_connect,
+  .reprovision = fake_reprovision,
+  .changed = fake_changed,
+};
+
+static const t_wifi_conn_driver fake_driver_noprov = {
+  .connect = fake_connect,
+  .reprovision = NULL,
+  .changed = fake_changed,
+};
+
+//helper, checks call i of fake
+#define CHECK_CALL(f, i, o, s) do { \
+    TEST_CHECK((i) < (f).count); \
+    TEST_CHECK_EQ((f).calls[i].op, o); \
+    if ((o) == FAKE_CHANGED) TEST_CHECK_EQ((f).calls[i].state, s); \
+  } while (0)
+
+//state is announced before driver is asked to act, every change exactly once
+static void test_notification_order(void)
+{
+  t_wifi_conn c;
+  t_fake f;
+
+  memset(&f, 0, sizeof(f));
+  wifi_conn_init(&c, &fake_driver, &f, 1 * S, 8 * S, 3, 1);
+  TEST_CHECK_EQ(f.count, 0);
+  TEST_CHECK_EQ(wifi_conn_deadline(&c), -1);
+
+  wifi_conn_event(&c, WIFI_CONN_EV_START, 0);
+  wifi_conn_event(&c, WIFI_CONN_EV_START, 0); //second start does nothing
+  TEST_CHECK_EQ(f.count, 2);
+  CHECK_CALL(f, 0, FAKE_CHANGED, WIFI_CONN_CONNECTING);
+  CHECK_CALL(f, 1, FAKE_CONNECT, 0);
+
+  wifi_conn_event(&c, WIFI_CONN_EV_GOT_IP, 1 * S);
+  TEST_CHECK_EQ(f.count, 3);
+  CHECK_CALL(f, 2, FAKE_CHANGED, WIFI_CONN_CONNECTED);
+
+  //lost connection is attempted again right away, no backoff
+  wifi_conn_event(&c, WIFI_CONN_EV_DISCONNECTED, 2 * S);
+  TEST_CHECK_EQ(f.count, 5);
+  CHECK_CALL(f, 3, FAKE_CHANGED, WIFI_CONN_CONNECTING);
+  CHECK_CALL(f, 4, FAKE_CONNECT, 0);
+  TEST_CHECK_EQ(c.drops, 1);
+
+  //failed attempt waits, timer before deadline and late disconnect are ignored
+  wifi_conn_event(&c, WIFI_CONN_EV_DISCONNECTED, 3 * S);
+  TEST_CHECK_EQ(f.count, 6);
+  CHECK_CALL(f, 5, FAKE_CHANGED, WIFI_CONN_BACKOFF);
+  wifi_conn_event(&c, WIFI_CONN_EV_DISCONNECTED, 3 * S);
+  wifi_conn_event(&c, WIFI_CONN_EV_TIMER, wifi_conn_deadline(&c) - 1);
+  TEST_CHECK_EQ(f.count, 6);
+
+  wifi_conn_event(&c, WIFI_CONN_EV_TIMER, wifi_conn_deadline(&c));
+  TEST_CHECK_EQ(f.count, 8);
+  CHECK_CALL(f, 6, FAKE_CHANGED, WIFI_CONN_CONNECTING);
+  CHECK_CALL(f, 7, FAKE_CONNECT, 0);
+  TEST_CHECK_EQ(wifi_conn_deadline(&c), -1);
+
+  wifi_conn_event(&c, WIFI_CONN_EV_GOT_IP, 10 * S);
+  TEST_CHECK_EQ(f.count, 9);
+  CHECK_CALL(f, 8, FAKE_CHANGED, WIFI_CONN_CONNECTED);
+  TEST_CHECK_EQ(c.attempts, 3);
+  TEST_CHECK_EQ(c.connects, 2);
+}
+
+//backoff waits from <backoff/2, backoff), doubles up to max and is reset by connection
+static void test_backoff_jitter(void)
+{
+  t_wifi_conn c;
+  t_fake f;
+  int64_t now, backoff, wait, first = -1;
+  int differ = 0;
+
+  for (uint32_t seed = 0; seed < 100; seed++)
+  {
+    memset(&f, 0, sizeof(f));
+    wifi_conn_init(&c, &fake_driver, &f, 1 * S, 8 * S, 0, seed);
+    now = 100 * S;
+    wifi_conn_event(&c, WIFI_CONN_EV_START, now);
+
+    backoff = 1 * S;
+    for (int i = 0; i < 8; i++)
+    {
+      wifi_conn_event(&c, WIFI_CONN_EV_DISCONNECTED, now);
+      TEST_CHECK_EQ(c.state, WIFI_CONN_BACKOFF);
+      wait = wifi_conn_deadline(&c) - now;
+      TEST_CHECK(wait >= backoff / 2);
+      TEST_CHECK(wait < backoff);
+      if (i == 0)
+      {
+        if (first < 0) first = wait;
+        else if (wait != first) differ = 1;
+      }
+
+      now += wait;
+      wifi_conn_event(&c, WIFI_CONN_EV_TIMER, now);
+      TEST_CHECK_EQ(c.state, WIFI_CONN_CONNECTING);
+      backoff = backoff * 2 > 8 * S ? 8 * S : backoff * 2;
+      TEST_CHECK_EQ(c.backoff, backoff);
+    }
+    TEST_CHECK_EQ(c.failures, 8);
+
+    wifi_conn_event(&c, WIFI_CONN_EV_GOT_IP, now);
+    TEST_CHECK_EQ(c.backoff, 1 * S);
+    TEST_CHECK_EQ(c.failures, 0);
+  }
+  //devices do not retry in lockstep
+  TEST_CHECK(differ);
+}
+
+//consecutive rejected credentials start provisioning, other failures break the row
+static void test_reprovision(void)
+{
+  t_wifi_conn c;
+  t_fake f;
+  int64_t now = 0;
+
+  memset(&f, 0, sizeof(f));
+  wifi_conn_init(&c, &fake_driver, &f, 1 * S, 8 * S, 3, 7);
+  wifi_conn_event(&c, WIFI_CONN_EV_START, now);
+
+  //auth, auth, disconnect: row is broken
+  for (int i = 0; i < 3; i++)
+  {
+    wifi_conn_event(&c, i < 2 ? WIFI_CONN_EV_AUTH_FAILED : WIFI_CONN_EV_DISCONNECTED, now);
+    TEST_CHECK_EQ(c.state, WIFI_CONN_BACKOFF);
+    now = wifi_conn_deadline(&c);
+    wifi_conn_event(&c, WIFI_CONN_EV_TIMER, now);
+  }
+  TEST_CHECK_EQ(c.auth_failures, 0);
+
+  //three in row
+  for (int i = 0; i < 2; i++)
+  {
+    wifi_conn_event(&c, WIFI_CONN_EV_AUTH_FAILED, now);
+    TEST_CHECK_EQ(c.state, WIFI_CONN_BACKOFF);
+    now = wifi_conn_deadline(&c);
+    wifi_conn_event(&c, WIFI_CONN_EV_TIMER, now);
+  }
+  f.count = 0;
+  wifi_conn_event(&c, WIFI_CONN_EV_AUTH_FAILED, now);
+  TEST_CHECK_EQ(c.state, WIFI_CONN_REPROVISION);
+  TEST_CHECK_EQ(f.count, 2);
+  CHECK_CALL(f, 0, FAKE_CHANGED, WIFI_CONN_REPROVISION);
+  CHECK_CALL(f, 1, FAKE_REPROVISION, 0);
+  TEST_CHECK_EQ(wifi_conn_deadline(&c), -1);
+
+  //provisioning is in charge until it connects
+  wifi_conn_event(&c, WIFI_CONN_EV_AUTH_FAILED, now);
+  wifi_conn_event(&c, WIFI_CONN_EV_DISCONNECTED, now);
+  wifi_conn_event(&c, WIFI_CONN_EV_TIMER, now + 100 * S);
+  wifi_conn_event(&c, WIFI_CONN_EV_START, now);
+  TEST_CHECK_EQ(f.count, 2);
+  TEST_CHECK_EQ(c.state, WIFI_CONN_REPROVISION);
+
+  wifi_conn_event(&c, WIFI_CONN_EV_GOT_IP, now);
+  TEST_CHECK_EQ(c.state, WIFI_CONN_CONNECTED);
+  TEST_CHECK_EQ(c.auth_failures, 0);
+  CHECK_CALL(f, 2, FAKE_CHANGED, WIFI_CONN_CONNECTED);
+}
+
+//without provisioning support or with threshold 0 rejected credentials only back off
+static void test_no_reprovision(void)
+{
+  const t_wifi_conn_driver *drivers[] = {&fake_driver_noprov, &fake_driver};
+  t_wifi_conn c;
+  t_fake f;
+  int64_t now = 0;
+
+  for (int d = 0; d < 2; d++)
+  {
+    memset(&f, 0, sizeof(f));
+    wifi_conn_init(&c, drivers[d], &f, 1 * S, 8 * S, d ? 0 : 3, 3);
+    wifi_conn_event(&c, WIFI_CONN_EV_START, now);
+    for (int i = 0; i < 10; i++)
+    {
+      wifi_conn_event(&c, WIFI_CONN_EV_AUTH_FAILED, now);
+      TEST_CHECK_EQ(c.state, WIFI_CONN_BACKOFF);
+      now = wifi_conn_deadline(&c);
+      wifi_conn_event(&c, WIFI_CONN_EV_TIMER, now);
+    }
+    for (int i = 0; i < f.count && i < FAKE_CALLS_MAX; i++) TEST_CHECK(f.calls[i].op != FAKE_REPROVISION);
+  }
+}
+
+int main(void)
+{
+  TEST_RUN(test_notification_order);
+  TEST_RUN(test_backoff_jitter);
+  TEST_RUN(test_reprovision);
+  TEST_RUN(test_no_reprovision);
+  return TEST_RESULT();
+}